@@ -0,0 +1,281 @@
+/**
+ * The MySensors Arduino library handles the wireless radio link and protocol
+ * between your home built sensors/actuators and HA controller of choice.
+ * The sensors forms a self healing radio network with optional repeaters. Each
+ * repeater and gateway builds a routing tables in EEPROM which keeps track of the
+ * network topology allowing messages to be routed to nodes.
+ *
+ * Created by Henrik Ekblad <henrik.ekblad@mysensors.org>
+ * Copyright (C) 2013-2015 Sensnology AB
+ * Full contributor list: https://github.com/mysensors/Arduino/graphs/contributors
+ *
+ * Documentation: http://www.mysensors.org
+ * Support Forum: http://forum.mysensors.org
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * version 2 as published by the Free Software Foundation.
+ */
+
+// Host test of MyFlashStore: values, history, wrap around (copying live values forward) and
+// recovery after a power loss at every point of a write.
+//
+// The SPIFlash driver is replaced by a model of a NOR flash in RAM: erasing sets bytes to 0xFF,
+// programming can only clear bits. A power loss is simulated by ignoring all erases and
+// programmed bytes once a budget runs out, then "rebooting" with a new store on the same flash.
+
+#include <MyFlashStore.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define TEST_FLASH_SIZE 0x20000
+
+static uint8_t flashMem[TEST_FLASH_SIZE];
+static long flashBudget = -1; // Bytes that can still be programmed (erase counts as one), -1 = no limit
+static bool otaTouched;
+static uint32_t flashErases;
+
+static bool flashPowered() {
+	if (flashBudget < 0)
+		return true;
+	if (flashBudget == 0)
+		return false;
+	flashBudget--;
+	return true;
+}
+
+static void flashProgram(uint32_t addr, uint8_t value) {
+	if (addr < MY_OTA_FLASH_SIZE)
+		otaTouched = true;
+	if (flashPowered())
+		flashMem[addr % TEST_FLASH_SIZE] &= value;
+}
+
+SPIFlash::SPIFlash(uint8_t slaveSelectPin, uint16_t jedecID) {
+	_slaveSelectPin = slaveSelectPin;
+	_jedecID = jedecID;
+	_pendingBuf = NULL;
+	_pendingLen = 0;
+}
+
+boolean SPIFlash::initialize() {
+	return true;
+}
+
+uint8_t SPIFlash::readByte(uint32_t addr) {
+	return flashMem[addr % TEST_FLASH_SIZE];
+}
+
+void SPIFlash::readBytes(uint32_t addr, void* buf, uint16_t len) {
+	for (uint16_t i = 0; i < len; i++)
+		((uint8_t*)buf)[i] = readByte(addr + i);
+}
+
+void SPIFlash::writeByte(uint32_t addr, uint8_t byt) {
+	flashProgram(addr, byt);
+}
+
+void SPIFlash::writeBytes(uint32_t addr, const void* buf, uint16_t len) {
+	for (uint16_t i = 0; i < len; i++)
+		flashProgram(addr + i, ((const uint8_t*)buf)[i]);
+}
+
+void SPIFlash::blockErase4K(uint32_t addr) {
+	addr &= ~(uint32_t)0xFFF;
+	flashErases++;
+	if (addr < MY_OTA_FLASH_SIZE)
+		otaTouched = true;
+	if (flashPowered())
+		memset(flashMem + addr % TEST_FLASH_SIZE, 0xFF, 4096);
+}
+
+static int failures;
+
+#define CHECK(cond) do { if (!(cond)) { printf("FAIL %s:%d: %s\n", __FILE__, __LINE__, #cond); failures++; } } while (0)
+
+static SPIFlash flash(0);
+
+static void eraseFlash() {
+	memset(flashMem, 0xFF, sizeof(flashMem));
+	flashBudget = -1;
+	otaTouched = false;
+}
+
+// Reads key and checks it holds the 4 byte value
+static bool holds(MyFlashStore &store, uint8_t key, uint32_t value) {
+	uint32_t v = 0;
+	uint8_t len;
+	return store.read(key, &v, sizeof(v), &len) && len == sizeof(v) && v == value;
+}
+
+static void testValues() {
+	eraseFlash();
+	MyFlashStore store(flash);
+	CHECK(store.begin());
+	uint8_t buf[FLASH_STORE_MAX_VALUE + 1];
+	uint8_t len = 0xAA;
+	CHECK(!store.read(0, buf, sizeof(buf), &len));
+	CHECK(store.write(1, buf, 0));
+	CHECK(store.read(1, buf, sizeof(buf), &len) && len == 0);
+	uint32_t v = 1234;
+	CHECK(store.write(2, &v, sizeof(v)));
+	CHECK(holds(store, 2, 1234));
+	CHECK(!store.write(MY_FLASH_STORE_KEYS, &v, sizeof(v)));
+	CHECK(!store.write(3, buf, FLASH_STORE_MAX_VALUE + 1));
+	CHECK(!store.append(buf, FLASH_STORE_MAX_VALUE + 1));
+
+	// Survives a reboot
+	MyFlashStore again(flash);
+	CHECK(again.begin());
+	CHECK(holds(again, 2, 1234));
+	CHECK(again.read(1, buf, sizeof(buf), &len) && len == 0);
+	CHECK(!again.read(0, buf, sizeof(buf), &len));
+}
+
+static void testLog() {
+	eraseFlash();
+	MyFlashStore store(flash);
+	CHECK(store.begin());
+	uint8_t len;
+	uint32_t v;
+	CHECK(!store.readLog(&v, sizeof(v), &len));
+	for (uint32_t i = 0; i < 5; i++)
+		CHECK(store.append(&i, sizeof(i)));
+	store.popLog();
+	CHECK(store.readLog(&v, sizeof(v), &len) && len == sizeof(v) && v == 1);
+
+	MyFlashStore again(flash);
+	CHECK(again.begin());
+	for (uint32_t i = 1; i < 5; i++) {
+		CHECK(again.readLog(&v, sizeof(v), &len) && v == i);
+		again.popLog();
+	}
+	CHECK(!again.readLog(&v, sizeof(v), &len));
+}
+
+static void testWrap() {
+	eraseFlash();
+	MyFlashStore store(flash);
+	CHECK(store.begin());
+	// Enough records to go round the ring several times
+	uint32_t last[MY_FLASH_STORE_KEYS];
+	for (uint32_t i = 0; i < 4000; i++) {
+		uint8_t key = i % MY_FLASH_STORE_KEYS;
+		// Key 0 is written once, it has to be copied forward on every wrap
+		if (key == 0 && i)
+			continue;
+		last[key] = i;
+		CHECK(store.write(key, &i, sizeof(i)));
+		if (i % 7 == 0)
+			CHECK(store.append(&i, sizeof(i)));
+	}
+	for (uint8_t key = 0; key < MY_FLASH_STORE_KEYS; key++)
+		CHECK(holds(store, key, last[key]));
+	// Oldest history was dropped with its sectors, what is left is in order
+	uint32_t v, prev = 0;
+	uint8_t len;
+	CHECK(store.readLog(&v, sizeof(v), &len));
+	CHECK(v > 0);
+
+	MyFlashStore again(flash);
+	CHECK(again.begin());
+	for (uint8_t key = 0; key < MY_FLASH_STORE_KEYS; key++)
+		CHECK(holds(again, key, last[key]));
+	while (again.readLog(&v, sizeof(v), &len)) {
+		CHECK(v > prev && v % 7 == 0);
+		prev = v;
+		again.popLog();
+	}
+	CHECK(!otaTouched);
+}
+
+// Key 0 is written once and has to survive every wrap, the other keys are written in turn
+static void fillStore(MyFlashStore &store, uint32_t writes) {
+	uint32_t fixed = 777;
+	store.write(0, &fixed, sizeof(fixed));
+	for (uint32_t i = 0; i < writes; i++)
+		store.write(1 + i % (MY_FLASH_STORE_KEYS - 1), &i, sizeof(i));
+}
+
+// Cuts the power at every byte of a write and checks the store comes back with either the old
+// or the new value. Covers ordinary writes and the writes that wrap into the next sector (erase
+// it, then copy the live values of the oldest sector forward).
+static void testPowerLoss() {
+	// Find the writes that wrap
+	uint32_t cases[24];
+	uint8_t count = 0;
+	for (uint32_t w = 1; w < 20; w += 6)
+		cases[count++] = w;
+	eraseFlash();
+	MyFlashStore scan(flash);
+	CHECK(scan.begin());
+	fillStore(scan, 0);
+	for (uint32_t i = 0; i < 6000 && count < sizeof(cases) / sizeof(cases[0]) - 1; i++) {
+		uint32_t erases = flashErases;
+		scan.write(1 + i % (MY_FLASH_STORE_KEYS - 1), &i, sizeof(i));
+		if (flashErases != erases) {
+			// i is the index of the write, so i records were written before it
+			cases[count++] = i;
+			cases[count++] = i + 1;
+		}
+	}
+	CHECK(count > 10);
+
+	uint32_t tested = 0;
+	for (uint8_t c = 0; c < count; c++) {
+		uint32_t writes = cases[c];
+		for (long budget = 0; budget < 160; budget++) {
+			eraseFlash();
+			MyFlashStore store(flash);
+			CHECK(store.begin());
+			fillStore(store, writes);
+			uint8_t key = 1 + writes % (MY_FLASH_STORE_KEYS - 1);
+			bool hasOld = writes >= MY_FLASH_STORE_KEYS - 1;
+			uint32_t old = writes - (MY_FLASH_STORE_KEYS - 1);
+			flashBudget = budget;
+			store.write(key, &writes, sizeof(writes));
+			flashBudget = -1;
+
+			MyFlashStore again(flash);
+			CHECK(again.begin());
+			uint32_t v;
+			uint8_t len;
+			if (hasOld)
+				CHECK(holds(again, key, old) || holds(again, key, writes));
+			else
+				CHECK(!again.read(key, &v, sizeof(v), &len) || holds(again, key, writes));
+			// Values being copied forward by an interrupted wrap are not lost
+			CHECK(holds(again, 0, 777));
+			if (writes)
+				CHECK(holds(again, 1 + (writes - 1) % (MY_FLASH_STORE_KEYS - 1), writes - 1));
+			// And the store keeps working
+			uint32_t next = writes + 1;
+			CHECK(again.write(key, &next, sizeof(next)));
+			CHECK(holds(again, key, next));
+			tested++;
+		}
+	}
+	printf("power loss cases: %lu\n", (unsigned long)tested);
+}
+
+static void testOtaRegion() {
+	eraseFlash();
+	MyFlashStore below(flash, 0);
+	CHECK(!below.begin());
+	MyFlashStore unaligned(flash, MY_OTA_FLASH_SIZE + 16);
+	CHECK(!unaligned.begin());
+	MyFlashStore above(flash, MY_OTA_FLASH_SIZE);
+	CHECK(above.begin());
+	CHECK(!otaTouched);
+}
+
+int main() {
+	testValues();
+	testLog();
+	testWrap();
+	testPowerLoss();
+	testOtaRegion();
+	printf("%s\n", failures ? "FAILED" : "OK");
+	return failures ? 1 : 0;
+}
@@ -0,0 +1,251 @@
+/**
+ * The MySensors Arduino library handles the wireless radio link and protocol
+ * between your home built sensors/actuators and HA controller of choice.
+ * The sensors forms a self healing radio network with optional repeaters. Each
+ * repeater and gateway builds a routing tables in EEPROM which keeps track of the
+ * network topology allowing messages to be routed to nodes.
+ *
+ * Created by Henrik Ekblad <henrik.ekblad@mysensors.org>
+ * Copyright (C) 2013-2015 Sensnology AB
+ * Full contributor list: https://github.com/mysensors/Arduino/graphs/contributors
+ *
+ * Documentation: http://www.mysensors.org
+ * Support Forum: http://forum.mysensors.org
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * version 2 as published by the Free Software Foundation.
+ */
+
+// Host benchmarks of the per message hot paths of the MySensors library.
+// Prints one CSV line per benchmark: name,iterations,ns_per_op
+
+#include <MySensor.h>
+#include <MyParserSerial.h>
+#include <MySigningAtsha204Soft.h>
+#include <utility/sha256.h>
+#include <time.h>
+
+// Minimum time spent in each benchmark
+#define BENCH_MIN_NS 200000000ULL
+
+static volatile uint32_t sink; // Keeps results alive
+
+// Makes the compiler assume the object at p is read (and memory changed), so work whose result
+// stays in memory (e.g. a message built by inline code) is not optimized away
+static inline void doNotOptimize(const void* p) {
+	asm volatile("" : : "g"(p) : "memory");
+}
+
+static uint64_t nowNs() {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+// Runs op in batches until BENCH_MIN_NS has passed and reports the average
+template <typename Op>
+static void bench(const char* name, Op op) {
+	uint64_t iterations = 0;
+	uint64_t batch = 16;
+	uint64_t start = nowNs();
+	uint64_t elapsed;
+	do {
+		for (uint64_t i = 0; i < batch; i++)
+			op();
+		iterations += batch;
+		if (batch < 65536)
+			batch *= 2;
+		elapsed = nowNs() - start;
+	} while (elapsed < BENCH_MIN_NS);
+	printf("%s,%llu,%.1f\n", name, (unsigned long long)iterations, (double)elapsed / iterations);
+	fflush(stdout);
+}
+
+// In-memory radio. send() always succeeds, available() hands out the packet set by deliver().
+class BenchTransport : public MyTransport
+{
+public:
+	BenchTransport() : _address(AUTO), _rxLen(0) {}
+	bool init() { return true; }
+	void setAddress(uint8_t address) { _address = address; }
+	uint8_t getAddress() { return _address; }
+	bool send(uint8_t to, const void* data, uint8_t len) { sink += to + len + ((const uint8_t*)data)[0]; return true; }
+	bool available(uint8_t *to) { *to = _address; return _rxLen != 0; }
+	uint8_t receive(void* data) { uint8_t len = _rxLen; memcpy(data, _rx, len); _rxLen = 0; return len; }
+	void powerDown() {}
+	void deliver(const MyMessage &msg) {
+		_rxLen = HEADER_SIZE + mGetLength(msg);
+		memcpy(_rx, &msg, _rxLen);
+	}
+private:
+	uint8_t _address;
+	uint8_t _rx[MAX_MESSAGE_LENGTH];
+	uint8_t _rxLen;
+};
+
+static void onMessage(const MyMessage &msg) {
+	sink += msg.type;
+}
+
+static void benchMessage() {
+	MyMessage msg(1, V_TEMP);
+	char buf[MAX_PAYLOAD * 2 + 1];
+	uint8_t raw[] = {1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12};
+
+	bench("message_set_byte", [&]{ msg.set((uint8_t)(sink & 0xff)); doNotOptimize(&msg); });
+	bench("message_set_int", [&]{ msg.set((int)-12345); doNotOptimize(&msg); });
+	bench("message_set_uint", [&]{ msg.set((unsigned int)54321); doNotOptimize(&msg); });
+	bench("message_set_long", [&]{ msg.set((long)-1234567890L); doNotOptimize(&msg); });
+	bench("message_set_ulong", [&]{ msg.set((unsigned long)3234567890UL); doNotOptimize(&msg); });
+	bench("message_set_float", [&]{ msg.set(23.45f, 2); doNotOptimize(&msg); });
+	bench("message_set_string", [&]{ msg.set("on the fly"); doNotOptimize(&msg); });
+	bench("message_set_custom", [&]{ msg.set(raw, sizeof(raw)); doNotOptimize(&msg); });
+
+	// Whole message, runtime header setters vs. compile time header
+	bench("message_build_float", [&]{
+		msg.sender = 1;
+		msg.destination = GATEWAY_ADDRESS;
+		msg.setSensor(2).setType(V_TEMP);
+		mSetCommand(msg, C_SET);
+		mSetRequestAck(msg, false);
+		mSetAck(msg, false);
+		msg.set((float)(sink & 0xff), 2);
+		doNotOptimize(&msg);
+	});
+	bench("message_build_typed_float", [&]{
+		MyTypedMessage<2, V_TEMP, P_FLOAT32>::build(msg, 1, GATEWAY_ADDRESS, (float)(sink & 0xff), 2);
+		doNotOptimize(&msg);
+	});
+
+	msg.set((uint8_t)200);
+	bench("message_getString_byte", [&]{ sink += msg.getString(buf)[0]; });
+	msg.set((int)-12345);
+	bench("message_getString_int", [&]{ sink += msg.getString(buf)[0]; });
+	msg.set((unsigned int)54321);
+	bench("message_getString_uint", [&]{ sink += msg.getString(buf)[0]; });
+	msg.set((long)-1234567890L);
+	bench("message_getString_long", [&]{ sink += msg.getString(buf)[0]; });
+	msg.set((unsigned long)3234567890UL);
+	bench("message_getString_ulong", [&]{ sink += msg.getString(buf)[0]; });
+	msg.set(23.45f, 2);
+	bench("message_getString_float", [&]{ sink += msg.getString(buf)[0]; });
+	msg.set("on the fly");
+	bench("message_getString_string", [&]{ sink += msg.getString(buf)[0]; });
+	msg.set(raw, sizeof(raw));
+	bench("message_getString_custom", [&]{ sink += msg.getString(buf)[0]; });
+
+	// Library formatting used by getString() before the fixed point formatting, for comparison
+	bench("format_ltoa_long", [&]{ sink += ltoa(-1234567890L, buf, 10)[0]; });
+	bench("format_ultoa_ulong", [&]{ sink += ultoa(3234567890UL, buf, 10)[0]; });
+	bench("format_dtostrf_float", [&]{ sink += dtostrf(23.45f, 2, 2, buf)[0]; });
+}
+
+static void benchParser() {
+	MyParserSerial parser;
+	MyMessage msg;
+	char input[32];
+	// parse() tokenizes in place, so every run gets a fresh copy
+	bench("parser_serial_set", [&]{
+		strcpy(input, "12;6;1;0;0;36.5\n");
+		sink += parser.parse(msg, input);
+	});
+	bench("parser_serial_custom", [&]{
+		strcpy(input, "12;6;1;0;24;0102030405AB\n");
+		sink += parser.parse(msg, input);
+	});
+}
+
+static void benchSigning() {
+	Sha256Class sha;
+	uint8_t data[32];
+	uint8_t key[32];
+	for (uint8_t i = 0; i < 32; i++) {
+		data[i] = i;
+		key[i] = 0xA5 ^ i;
+	}
+	bench("sha256_32b", [&]{
+		sha.init();
+		for (uint8_t i = 0; i < sizeof(data); i++)
+			sha.write(data[i]);
+		sink += sha.result()[0];
+	});
+	bench("hmac_sha256_32b", [&]{
+		sha.initHmac(key, sizeof(key));
+		for (uint8_t i = 0; i < sizeof(data); i++)
+			sha.write(data[i]);
+		sink += sha.resultHmac()[0];
+	});
+
+	// Sender signs with the nonce the receiver handed out, receiver verifies
+	MySigningAtsha204Soft sender, receiver;
+	MyMessage nonce, msg(1, V_TEMP);
+	msg.sender = 1;
+	msg.destination = 0;
+	msg.set(23.45f, 2);
+	receiver.getNonce(nonce);
+	sender.putNonce(nonce);
+	bench("signing_sign", [&]{
+		MyMessage signedMsg = msg;
+		sink += sender.signMsg(signedMsg);
+	});
+	MyMessage signedMsg = msg;
+	sender.signMsg(signedMsg);
+	bench("signing_getNonce_verify", [&]{
+		MyMessage check = signedMsg;
+		receiver.getNonce(nonce);
+		sink += receiver.verifyMsg(check); // fails (new nonce), but does the full work
+	});
+}
+
+static void benchCrc() {
+	uint8_t block[FIRMWARE_BLOCK_SIZE];
+	for (uint8_t i = 0; i < sizeof(block); i++)
+		block[i] = i * 7;
+	bench("crc16_firmware_block", [&]{ sink += MySensor::crc16(0xFFFF, block, sizeof(block)); });
+}
+
+static void benchNode() {
+	// Repeater with node 5 reachable through child 5
+	BenchTransport radio;
+	MyHwDriver hw;
+	MySensor node(radio, hw);
+	node.begin(onMessage, 1, true, GATEWAY_ADDRESS);
+	hw_writeConfig(EEPROM_ROUTES_ADDRESS + 5, 5);
+
+	MyMessage msg(3, V_TEMP);
+	msg.sender = 1;
+	msg.destination = 5;
+	msg.set(21.5f, 1);
+	bench("route_sendRoute_child", [&]{ sink += node.sendRoute(msg); });
+	msg.destination = GATEWAY_ADDRESS;
+	bench("route_sendRoute_parent", [&]{ sink += node.sendRoute(msg); });
+
+	// Message from the gateway for this node, handed to the callback
+	MyMessage in(3, V_STATUS);
+	in.last = GATEWAY_ADDRESS;
+	in.sender = GATEWAY_ADDRESS;
+	in.destination = 1;
+	mSetCommand(in, C_SET);
+	in.set((uint8_t)1);
+	bench("process_dispatch_local", [&]{
+		radio.deliver(in);
+		sink += node.process();
+	});
+	// Message from the gateway relayed to child 5
+	in.destination = 5;
+	bench("process_dispatch_relay", [&]{
+		radio.deliver(in);
+		sink += node.process();
+	});
+}
+
+int main() {
+	printf("name,iterations,ns_per_op\n");
+	benchMessage();
+	benchParser();
+	benchSigning();
+	benchCrc();
+	benchNode();
+	return 0;
+}
@@ -0,0 +1,161 @@
+/**
+ * The MySensors Arduino library handles the wireless radio link and protocol
+ * between your home built sensors/actuators and HA controller of choice.
+ * The sensors forms a self healing radio network with optional repeaters. Each
+ * repeater and gateway builds a routing tables in EEPROM which keeps track of the
+ * network topology allowing messages to be routed to nodes.
+ *
+ * Created by Henrik Ekblad <henrik.ekblad@mysensors.org>
+ * Copyright (C) 2013-2015 Sensnology AB
+ * Full contributor list: https://github.com/mysensors/Arduino/graphs/contributors
+ *
+ * Documentation: http://www.mysensors.org
+ * Support Forum: http://forum.mysensors.org
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * version 2 as published by the Free Software Foundation.
+ */
+
+// Gateway load test over MyTransportSocket.
+//
+//   MySensorsLoad [nodes] [messages]
+//
+// Forks one process per software node (ids 1..nodes), the parent runs the gateway. Every node
+// sends its messages with ack requested, one at a time, and measures the time until the ack of
+// the gateway arrives. Prints one CSV line:
+// nodes,messages,delivered,failed,lost,msgs_per_s,p50_us,p99_us,p999_us,max_us
+
+#include <MySensor.h>
+#include <MyTransportSocket.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <stdlib.h>
+#include <stdio.h>
+
+// Time a node waits for the ack of a message before counting it as lost
+#define LOAD_ACK_TIMEOUT_US 1000000UL
+// Sleep between polls of a waiting node, leaves the CPU to the gateway
+#define LOAD_POLL_US 200
+
+struct NodeResult {
+	uint32_t failed; // send() failed (gateway queue full)
+	uint32_t lost; // Sent, but no ack within LOAD_ACK_TIMEOUT_US
+	uint32_t acked; // Number of entries used in latency
+	uint32_t latency[1]; // Round trip times in us, sized at runtime
+};
+
+static volatile bool acked;
+static uint32_t gatewayReceived;
+
+static void nodeCallback(const MyMessage &message) {
+	if (mGetAck(message))
+		acked = true;
+}
+
+static void gatewayCallback(const MyMessage &message) {
+	if (!mGetAck(message) && mGetCommand(message) == C_SET)
+		gatewayReceived++;
+}
+
+static void runNode(const char* network, uint8_t id, uint32_t messages, NodeResult* result, int startFd) {
+	MyTransportSocket transport(network);
+	MyHwLinux hw;
+	MySensor node(transport, hw);
+	char c;
+	// Wait until the gateway is up (the parent closes the pipe)
+	while (read(startFd, &c, 1) > 0) {}
+	node.begin(nodeCallback, id, false, 0);
+	MyMessage msg(1, V_TEMP);
+	for (uint32_t i = 0; i < messages; i++) {
+		acked = false;
+		unsigned long start = micros();
+		if (!node.send(msg.set(i), true)) {
+			result->failed++;
+			continue;
+		}
+		while (!acked && micros() - start < LOAD_ACK_TIMEOUT_US) {
+			node.process();
+			if (!acked)
+				usleep(LOAD_POLL_US);
+		}
+		if (acked)
+			result->latency[result->acked++] = micros() - start;
+		else
+			result->lost++;
+	}
+}
+
+static int compareU32(const void* a, const void* b) {
+	uint32_t x = *(const uint32_t*)a, y = *(const uint32_t*)b;
+	return x < y ? -1 : x > y;
+}
+
+int main(int argc, char** argv) {
+	int nodes = argc > 1 ? atoi(argv[1]) : 32;
+	uint32_t messages = argc > 2 ? strtoul(argv[2], NULL, 10) : 200;
+	if (nodes < 1 || nodes > 254 || !messages) {
+		fprintf(stderr, "usage: %s [nodes 1-254] [messages]\n", argv[0]);
+		return 1;
+	}
+	// Own network name, so concurrent runs don't mix
+	char network[32];
+	snprintf(network, sizeof(network), "load-%d", (int)getpid());
+
+	// Results written by the node processes
+	size_t resultSize = (sizeof(NodeResult) + messages * sizeof(uint32_t) + 7) & ~(size_t)7;
+	uint8_t* results = (uint8_t*)mmap(NULL, resultSize * nodes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+	int start[2];
+	if (results == MAP_FAILED || pipe(start) < 0) {
+		perror("MySensorsLoad");
+		return 1;
+	}
+	for (int n = 0; n < nodes; n++) {
+		pid_t pid = fork();
+		if (pid < 0) {
+			perror("fork");
+			return 1;
+		}
+		if (!pid) {
+			close(start[1]);
+			runNode(network, n + 1, messages, (NodeResult*)(results + resultSize * n), start[0]);
+			_exit(0);
+		}
+	}
+	close(start[0]);
+
+	MyTransportSocket transport(network);
+	MyHwLinux hw;
+	MySensor gw(transport, hw);
+	gw.begin(gatewayCallback, 0, true);
+	gatewayReceived = 0;
+	unsigned long begin = micros();
+	close(start[1]);
+	int running = nodes;
+	while (running) {
+		gw.process();
+		while (running && waitpid(-1, NULL, WNOHANG) > 0)
+			running--;
+	}
+	double seconds = (micros() - begin) / 1e6;
+
+	uint32_t failed = 0, lost = 0, count = 0;
+	uint32_t* all = (uint32_t*)malloc((size_t)nodes * messages * sizeof(uint32_t));
+	for (int n = 0; n < nodes; n++) {
+		NodeResult* r = (NodeResult*)(results + resultSize * n);
+		failed += r->failed;
+		lost += r->lost;
+		for (uint32_t i = 0; i < r->acked; i++)
+			all[count++] = r->latency[i];
+	}
+	qsort(all, count, sizeof(uint32_t), compareU32);
+	#define PERCENTILE(p) (count ? all[(uint32_t)((count - 1) * (p))] : 0)
+	printf("nodes,messages,delivered,failed,lost,msgs_per_s,p50_us,p99_us,p999_us,max_us\n");
+	printf("%d,%lu,%lu,%lu,%lu,%.0f,%lu,%lu,%lu,%lu\n", nodes, (unsigned long)messages * nodes,
+		(unsigned long)gatewayReceived, (unsigned long)failed, (unsigned long)lost, gatewayReceived / seconds,
+		(unsigned long)PERCENTILE(0.5), (unsigned long)PERCENTILE(0.99), (unsigned long)PERCENTILE(0.999),
+		(unsigned long)PERCENTILE(1.0));
+	free(all);
+	return 0;
+}
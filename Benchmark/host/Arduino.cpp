@@ -0,0 +1,55 @@
+// Host implementation of the Arduino shim, see Arduino.h
+#include "Arduino.h"
+#include "SPI.h"
+#include <time.h>
+#include <unistd.h>
+
+HardwareSerial Serial;
+SPIClass SPI;
+
+static uint64_t nowMicros() {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+unsigned long millis() { return nowMicros() / 1000; }
+unsigned long micros() { return nowMicros(); }
+void delay(unsigned long ms) { usleep(ms * 1000); }
+void delayMicroseconds(unsigned int us) { usleep(us); }
+
+long random(long howbig) { return howbig ? rand() % howbig : 0; }
+long random(long howsmall, long howbig) { return howsmall >= howbig ? howsmall : howsmall + random(howbig - howsmall); }
+void randomSeed(unsigned long seed) { if (seed) srand(seed); }
+
+char* ultoa(unsigned long value, char* buf, int radix) {
+	char tmp[33];
+	int i = 0;
+	do {
+		int d = value % radix;
+		tmp[i++] = d < 10 ? '0' + d : 'a' + d - 10;
+		value /= radix;
+	} while (value);
+	int j = 0;
+	while (i)
+		buf[j++] = tmp[--i];
+	buf[j] = '\0';
+	return buf;
+}
+
+char* ltoa(long value, char* buf, int radix) {
+	if (value < 0 && radix == 10) {
+		buf[0] = '-';
+		ultoa(-(unsigned long)value, buf + 1, radix);
+		return buf;
+	}
+	return ultoa((unsigned long)value, buf, radix);
+}
+
+char* itoa(int value, char* buf, int radix) { return radix == 10 ? ltoa(value, buf, radix) : ultoa((unsigned int)value, buf, radix); }
+char* utoa(unsigned int value, char* buf, int radix) { return ultoa(value, buf, radix); }
+
+char* dtostrf(double value, signed char width, unsigned char prec, char* buf) {
+	sprintf(buf, "%*.*f", width, prec, value);
+	return buf;
+}
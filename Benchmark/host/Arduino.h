@@ -0,0 +1,90 @@
+// Minimal Arduino API for building the MySensors library on a Linux host.
+// Only what the library core needs; radio drivers are not built.
+#ifndef Arduino_h
+#define Arduino_h
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdarg.h>
+#include <math.h>
+
+typedef bool boolean;
+typedef uint8_t byte;
+typedef uint16_t word;
+
+#define HIGH 0x1
+#define LOW  0x0
+#define INPUT 0x0
+#define OUTPUT 0x1
+#define INPUT_PULLUP 0x2
+#define CHANGE 1
+#define FALLING 2
+#define RISING 3
+#define DEC 10
+#define HEX 16
+#define SS 10
+
+// Spelled like the fallbacks in RF24_config.h so both can be included
+#define PROGMEM
+#define PSTR(x) (x)
+#define F(s) (s)
+#define pgm_read_byte(addr) (*(const unsigned char *)(addr))
+#define pgm_read_word(p) (*(p))
+#define pgm_read_dword(addr) (*(const uint32_t*)(addr))
+#define strlen_P strlen
+#define strcpy_P strcpy
+#define memcpy_P memcpy
+#define snprintf_P snprintf
+#define vsnprintf_P vsnprintf
+class __FlashStringHelper;
+
+#ifndef min
+#define min(a,b) ((a)<(b)?(a):(b))
+#endif
+#ifndef max
+#define max(a,b) ((a)>(b)?(a):(b))
+#endif
+
+unsigned long millis();
+unsigned long micros();
+void delay(unsigned long ms);
+void delayMicroseconds(unsigned int us);
+inline void pinMode(uint8_t, uint8_t) {}
+inline void digitalWrite(uint8_t, uint8_t) {}
+inline int digitalRead(uint8_t) { return LOW; }
+inline int analogRead(uint8_t) { return 0; }
+inline void noInterrupts() {}
+inline void interrupts() {}
+inline void attachInterrupt(uint8_t, void (*)(void), int) {}
+inline void detachInterrupt(uint8_t) {}
+long random(long howbig);
+long random(long howsmall, long howbig);
+void randomSeed(unsigned long seed);
+
+// avr-libc conversions
+char* itoa(int value, char* buf, int radix);
+char* utoa(unsigned int value, char* buf, int radix);
+char* ltoa(long value, char* buf, int radix);
+char* ultoa(unsigned long value, char* buf, int radix);
+char* dtostrf(double value, signed char width, unsigned char prec, char* buf);
+
+// Serial goes to stdout
+class HardwareSerial {
+public:
+	void begin(unsigned long) {}
+	int available() { return 0; }
+	int read() { return -1; }
+	void flush() { fflush(stdout); }
+	size_t write(uint8_t c) { return fputc(c, stdout) == EOF ? 0 : 1; }
+	size_t print(const char* s) { return fputs(s, stdout) == EOF ? 0 : strlen(s); }
+	size_t print(char c) { return write(c); }
+	size_t print(long n, int base=DEC) { return printf(base == HEX ? "%lX" : "%ld", n); }
+	size_t println(const char* s="") { return print(s) + write('\n'); }
+	size_t println(long n, int base=DEC) { return print(n, base) + write('\n'); }
+	operator bool() { return true; }
+};
+extern HardwareSerial Serial;
+
+#endif
@@ -0,0 +1,19 @@
+// Host stand-in for the Arduino SPI library (no SPI devices on the host)
+#ifndef SPI_h
+#define SPI_h
+#include <Arduino.h>
+#define SPI_MODE0 0x00
+#define SPI_CLOCK_DIV2 0x04
+#define SPI_CLOCK_DIV4 0x00
+#define MSBFIRST 1
+class SPIClass {
+public:
+	static void begin() {}
+	static void end() {}
+	static uint8_t transfer(uint8_t) { return 0xFF; }
+	static void setDataMode(uint8_t) {}
+	static void setBitOrder(uint8_t) {}
+	static void setClockDivider(uint8_t) {}
+};
+extern SPIClass SPI;
+#endif
@@ -0,0 +1,2 @@
+// Host stand-in for avr-libc's pgmspace.h, everything lives in RAM
+#include <Arduino.h>
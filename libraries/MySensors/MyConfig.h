@@ -23,19 +23,35 @@
 #include <stdint.h>
 
 // Enable debug flag for debug prints. This will add a lot to the size of the final sketch but good
-// to see what is actually is happening when developing
+// to see what is actually is happening when developing. Define MY_NO_DEBUG (e.g. on the compiler
+// command line) to build without it.
+#ifndef MY_NO_DEBUG
 #define DEBUG
+#endif
 
 // Enable MY_DEBUG_VERBOSE flag for verbose debug prints. Requires DEBUG to be enabled.
 // This will add even more to the size of the final sketch!
 //#define MY_DEBUG_VERBOSE
 
+// Enable MY_TRACE to record sent and received packets as binary events (time and header) in a RAM
+// ring instead of printing them while sending/receiving. Much less intrusive than the debug prints,
+// so timing problems stay reproducible. Print the events with traceDump() where timing doesn't
+// matter (e.g. before sleep()). Requires DEBUG to be enabled, other debug prints are kept.
+//#define MY_TRACE
+// Number of events kept (13 bytes RAM each). When full, the oldest event is overwritten.
+#define MY_TRACE_SIZE 16
+
 // Disable this line, If you are using TX(1), RX(0) as normal I/O pin
 #define ENABLED_SERIAL
 
 // Serial output baud rate (for debug prints and serial gateway)
 #define BAUD_RATE 115200
 
+// Largest message (header + payload) in bytes. 32 fits every radio. RFM69 networks can raise
+// it to 38, which is the limit of the 5 bit payload length field (31 bytes). Sending a message
+// longer than the MTU of the radio fails. Use the same value on all nodes of the network.
+#define MY_MAX_MESSAGE_LENGTH 32
+
 
 /**********************************
 *  Over the air firmware updates
@@ -52,6 +68,111 @@
 #define MY_OTA_FLASH_JDECID 0x1F65
 
 
+/**********************************
+*  External flash key-value/log store
+***********************************/
+
+// External flash reserved for OTA firmware images (from address 0). MyFlashStore refuses
+// to start below it.
+#define MY_OTA_FLASH_SIZE 0x8000
+// Default location of MyFlashStore in external flash (4K aligned, at or after MY_OTA_FLASH_SIZE)
+#define MY_FLASH_STORE_START 0x10000
+// Number of 4K sectors used by the store (minimum 2). One sector is always kept erased.
+#define MY_FLASH_STORE_SECTORS 4
+// Number of value keys (0 - MY_FLASH_STORE_KEYS-1) kept indexed in RAM (4 bytes RAM each)
+#define MY_FLASH_STORE_KEYS 16
+
+
+/**********************************
+*  saveState() journaling
+***********************************/
+
+// Enable to spread saveState() writes for the first MY_EEPROM_JOURNAL_POSITIONS positions
+// over a journal region in EEPROM. Each write goes to the next record in a ring, which
+// multiplies the EEPROM endurance for sketches that save often (e.g. pulse counters).
+// Journaled positions are shadowed in RAM so loadState() and unchanged saves never touch EEPROM.
+//#define MY_EEPROM_JOURNAL
+// Number of state positions (0 - MY_EEPROM_JOURNAL_POSITIONS-1) handled by the journal
+#define MY_EEPROM_JOURNAL_POSITIONS 8
+// Number of 3 byte records in the journal (max 254)
+#define MY_EEPROM_JOURNAL_RECORDS 64
+
+
+/**********************************
+*  Node statistics
+***********************************/
+
+// Enable to count sent, failed, received, relayed and dropped packets, parent changes, signing
+// failures and time spent in process()/wait() (see NodeStats in MySensor.h, 23 bytes RAM).
+// The controller pulls them by sending an I_STATS internal message to the node, the reply
+// carries the NodeStats struct as binary (hex on the gateway serial line) payload.
+//#define MY_NODE_STATS
+// Enable to also push the statistics after every sendHeartbeat()
+//#define MY_NODE_STATS_WITH_HEARTBEAT
+
+
+/**********************************
+*  Reporting slots
+***********************************/
+
+// Enable to let sleeping nodes report in their own time slot of a cycle (see sleepUntilSlot()),
+// instead of all waking up at the same time after a power cut. The gateway is the clock of the
+// network and tells the nodes where their slot is (I_SLOT). Enable on the gateway and the nodes.
+//#define MY_SLOTS
+// Length of the reporting cycle in ms
+#define MY_SLOT_PERIOD 60000UL
+// Number of slots in a cycle. Node n reports in slot n % MY_SLOT_COUNT.
+#define MY_SLOT_COUNT 60
+// Ask the gateway for the slot position again after this many cycles. Each sync also measures
+// how fast the sleep timer of the node runs (the watchdog oscillator is off by up to 10%).
+#define MY_SLOT_RESYNC 10
+
+
+/**********************************
+*  Gateway node table
+***********************************/
+
+// Enable on the gateway to keep track of the nodes it hears from: parent, distance, last
+// heartbeat counter and when the node was last seen. The controller can list the table with
+// an I_NODE_TABLE message. Nodes not heard from for MY_NODE_TIMEOUT are marked dead.
+// Routes are only removed for nodes that send heartbeats and missed MY_NODE_HEARTBEAT_MISSES
+// of them, so the gateway stops sending to them. Sleeping nodes that only report on events keep
+// their route. A removed route costs one EEPROM write and comes back (another write) with the
+// next message from the node.
+//#define MY_NODE_TABLE
+// Number of nodes tracked (13 bytes RAM each). When full, the node seen longest ago is dropped.
+#define MY_NODE_TABLE_SIZE 32
+// A node is marked dead after this many ms without a message. Use a few times the longest
+// report interval of the nodes.
+#define MY_NODE_TIMEOUT 3600000UL
+// Heartbeat intervals a node may stay silent before its route is removed
+#define MY_NODE_HEARTBEAT_MISSES 3
+
+
+/**********************************
+*  End-to-end acknowledgement
+***********************************/
+
+// Enable to add sendReliable(), which retransmits a message until the destination itself (not
+// just the first hop) acknowledges it. Messages requesting an ack and the acks carry a message
+// id byte after the payload, so receivers can drop retransmitted duplicates and acks can be
+// matched to the right message. Nodes without the feature ignore the extra byte. Enable on all
+// nodes, repeaters included, or the id gets lost on the way (acks are then matched by
+// sensor and type).
+//#define MY_E2E_ACK_FEATURE
+// Number of retransmissions before sendReliable() gives up
+#define MY_E2E_RETRIES 3
+// Retransmission timeout (ms) before the round trip time to a destination has been measured
+#define MY_E2E_INITIAL_RTO 1000
+// Limits of the retransmission timeout (ms)
+#define MY_E2E_MIN_RTO 100
+#define MY_E2E_MAX_RTO 8000
+// Number of destinations with a measured round trip time (5 bytes RAM each)
+#define MY_E2E_DESTINATIONS 4
+// Number of (sender, message id) pairs remembered to drop duplicates (2 bytes RAM each)
+#define MY_E2E_DUPLICATES 8
+
+
 /**********************************
 *  Information LEDs blinking
 ***********************************/
@@ -124,6 +245,18 @@
 // This is also act as base value for sensor nodeId addresses. Change this (or channel) if you have more than one sensor network.
 #define RF24_BASE_RADIO_ID ((uint64_t)0xA8A8E1FC00LL)
 
+// Enable this to use the IRQ pin of the NRF24L01 radio (interrupt number, 0 = pin 2 on ATMega328).
+// Received packets are then moved from the (3 deep) radio FIFO into a RAM queue as soon as they arrive.
+// Other SPI devices must use SPI transactions (SPI.usingInterrupt() masks the IRQ during them) and
+// sleep() can't wake up on this interrupt (it is rejected).
+//#define RF24_IRQ_NUM 0
+// Number of received packets the RAM queue can hold (34 bytes each)
+#define RF24_RX_QUEUE_SIZE 4
+
+// Enable this to let repeaters and the gateway hand a message that could not be delivered to a
+// (sleeping) child over with the ACK of the next message from that child. Must be enabled on all nodes.
+//#define MY_ACK_PAYLOAD_FEATURE
+
 // Enable SOFTSPI for NRF24L01 when using the W5100 Ethernet module
 //#define SOFTSPI
 #ifdef SOFTSPI
@@ -149,4 +282,14 @@
 //#define RFM69_ENABLE_ENCRYPTION
 #define RFM69_ENCRYPTKEY    "sampleEncryptKey" //exactly the same 16 characters/bytes on all nodes!
 
+// Number of received frames the interrupt handler can queue (66 bytes each). The receiver
+// is re-armed right after each frame, so back to back frames are no longer lost while the
+// sketch is busy.
+#define RFM69_RX_QUEUE_SIZE 3
+
+// Enable this to let the node lower (or raise) its transmit power until the RSSI its ACKs
+// report is around this value (dBm). Saves battery on nodes close to their parent.
+// The gateway/repeaters need this driver version to report the RSSI, but not the define.
+//#define RFM69_ATC_TARGET_RSSI -80
+
 #endif
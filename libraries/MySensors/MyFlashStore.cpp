@@ -0,0 +1,257 @@
+/**
+ * The MySensors Arduino library handles the wireless radio link and protocol
+ * between your home built sensors/actuators and HA controller of choice.
+ * The sensors forms a self healing radio network with optional repeaters. Each
+ * repeater and gateway builds a routing tables in EEPROM which keeps track of the
+ * network topology allowing messages to be routed to nodes.
+ *
+ * Created by Henrik Ekblad <henrik.ekblad@mysensors.org>
+ * Copyright (C) 2013-2015 Sensnology AB
+ * Full contributor list: https://github.com/mysensors/Arduino/graphs/contributors
+ *
+ * Documentation: http://www.mysensors.org
+ * Support Forum: http://forum.mysensors.org
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * version 2 as published by the Free Software Foundation.
+ */
+
+#include "MyFlashStore.h"
+
+// Sector header: magic (2 bytes) + sequence number (2 bytes)
+#define FLASH_STORE_HEADER_SIZE 4
+#define FLASH_STORE_MAGIC0 'M'
+#define FLASH_STORE_MAGIC1 'S'
+
+// Record header: state, key, length. Followed by length bytes of data.
+#define FLASH_STORE_RECORD_HEADER_SIZE 3
+#define FLASH_STORE_FREE 0xFF // Erased flash
+#define FLASH_STORE_COMMITTED 0x7E // Data completely written
+#define FLASH_STORE_CONSUMED 0x00 // History record has been popped
+
+// The live values of all keys must always fit in a single sector when the oldest sector is recycled
+#if MY_FLASH_STORE_KEYS * (FLASH_STORE_MAX_VALUE + FLASH_STORE_RECORD_HEADER_SIZE) > FLASH_STORE_SECTOR_SIZE - FLASH_STORE_HEADER_SIZE
+#error MY_FLASH_STORE_KEYS too large
+#endif
+
+#define FLASH_STORE_NONE 0xFFFFFFFF
+
+#if MY_FLASH_STORE_START < MY_OTA_FLASH_SIZE || MY_FLASH_STORE_START % FLASH_STORE_SECTOR_SIZE
+#error MY_FLASH_STORE_START must be 4K aligned and clear of the OTA image (MY_OTA_FLASH_SIZE)
+#endif
+
+
+MyFlashStore::MyFlashStore(SPIFlash &flash, uint32_t start, uint8_t sectors)
+	:
+	_flash(flash),
+	_start(start),
+	_sectors(sectors < 2 ? 2 : sectors)
+{
+}
+
+uint32_t MyFlashStore::sectorAddr(uint8_t sector) {
+	return _start + (uint32_t)sector * FLASH_STORE_SECTOR_SIZE;
+}
+
+bool MyFlashStore::sectorHeader(uint8_t sector, uint16_t *seq) {
+	uint8_t hdr[FLASH_STORE_HEADER_SIZE];
+	_flash.readBytes(sectorAddr(sector), hdr, FLASH_STORE_HEADER_SIZE);
+	if (hdr[0] != FLASH_STORE_MAGIC0 || hdr[1] != FLASH_STORE_MAGIC1)
+		return false;
+	if (seq != NULL)
+		*seq = hdr[2] | (hdr[3] << 8);
+	return true;
+}
+
+bool MyFlashStore::begin() {
+	// Every address used lies at or after _start, so this keeps staged firmware images intact
+	if (_start < MY_OTA_FLASH_SIZE || _start % FLASH_STORE_SECTOR_SIZE)
+		return false;
+	if (!_flash.initialize())
+		return false;
+
+	for (uint8_t i = 0; i < MY_FLASH_STORE_KEYS; i++)
+		_index[i] = FLASH_STORE_NONE;
+	_logAddr = FLASH_STORE_NONE;
+
+	// Head is the valid sector with the highest sequence number
+	bool found = false;
+	uint16_t seq;
+	for (uint8_t s = 0; s < _sectors; s++) {
+		if (sectorHeader(s, &seq) && (!found || (int16_t)(seq - _seq) > 0)) {
+			_head = s;
+			_seq = seq;
+			found = true;
+		}
+	}
+	if (!found) {
+		// Empty or corrupt region, start over
+		_seq = 0;
+		openSector(0);
+		return true;
+	}
+
+	// Rebuild index, oldest sector first so later records override earlier ones.
+	// Head is scanned last which leaves the append position in _writeAddr.
+	for (uint8_t i = 1; i <= _sectors; i++) {
+		uint8_t s = (_head + i) % _sectors;
+		if (sectorHeader(s, NULL))
+			_writeAddr = scanSector(s);
+	}
+
+	// Sector after head should always be free. If not we lost power
+	// while wrapping around, finish the job. Head only holds values copied
+	// so far so the remaining ones are guaranteed to fit.
+	uint8_t next = (_head + 1) % _sectors;
+	if (sectorHeader(next, NULL))
+		recycleSector(next);
+	return true;
+}
+
+uint32_t MyFlashStore::scanSector(uint8_t sector) {
+	uint32_t addr = sectorAddr(sector) + FLASH_STORE_HEADER_SIZE;
+	uint32_t end = sectorAddr(sector) + FLASH_STORE_SECTOR_SIZE;
+	uint8_t hdr[FLASH_STORE_RECORD_HEADER_SIZE];
+	while (addr + FLASH_STORE_RECORD_HEADER_SIZE <= end) {
+		_flash.readBytes(addr, hdr, FLASH_STORE_RECORD_HEADER_SIZE);
+		if (hdr[0] == FLASH_STORE_FREE && hdr[1] == FLASH_STORE_FREE && hdr[2] == FLASH_STORE_FREE)
+			break;
+		// Uncommitted records (torn writes) are skipped
+		if (hdr[0] == FLASH_STORE_COMMITTED) {
+			if (hdr[1] < MY_FLASH_STORE_KEYS)
+				_index[hdr[1]] = addr;
+			else if (hdr[1] == FLASH_STORE_LOG_KEY && _logAddr == FLASH_STORE_NONE)
+				_logAddr = addr;
+		}
+		addr += FLASH_STORE_RECORD_HEADER_SIZE + hdr[2];
+	}
+	return addr;
+}
+
+// Returns the first unread history record at or after addr, following sectors in ring order up to head
+uint32_t MyFlashStore::nextLog(uint32_t addr) {
+	uint8_t hdr[FLASH_STORE_RECORD_HEADER_SIZE];
+	// addr may point just past the end of its sector
+	uint8_t sector = (addr - 1 - _start) / FLASH_STORE_SECTOR_SIZE;
+	while (addr != _writeAddr) {
+		if (addr + FLASH_STORE_RECORD_HEADER_SIZE <= sectorAddr(sector) + FLASH_STORE_SECTOR_SIZE) {
+			_flash.readBytes(addr, hdr, FLASH_STORE_RECORD_HEADER_SIZE);
+			if (hdr[0] != FLASH_STORE_FREE || hdr[1] != FLASH_STORE_FREE || hdr[2] != FLASH_STORE_FREE) {
+				if (hdr[0] == FLASH_STORE_COMMITTED && hdr[1] == FLASH_STORE_LOG_KEY)
+					return addr;
+				addr += FLASH_STORE_RECORD_HEADER_SIZE + hdr[2];
+				continue;
+			}
+		}
+		// End of sector, continue in the next one
+		if (sector == _head)
+			break;
+		sector = (sector + 1) % _sectors;
+		addr = sectorAddr(sector) + FLASH_STORE_HEADER_SIZE;
+	}
+	return FLASH_STORE_NONE;
+}
+
+void MyFlashStore::openSector(uint8_t sector) {
+	uint32_t addr = sectorAddr(sector);
+	_flash.blockErase4K(addr);
+	_seq++;
+	uint8_t hdr[FLASH_STORE_HEADER_SIZE] = {FLASH_STORE_MAGIC0, FLASH_STORE_MAGIC1, (uint8_t)(_seq & 0xff), (uint8_t)(_seq >> 8)};
+	_flash.writeBytes(addr, hdr, FLASH_STORE_HEADER_SIZE);
+	_head = sector;
+	_writeAddr = addr + FLASH_STORE_HEADER_SIZE;
+}
+
+void MyFlashStore::recycleSector(uint8_t sector) {
+	uint32_t start = sectorAddr(sector);
+	uint32_t end = start + FLASH_STORE_SECTOR_SIZE;
+	uint8_t buf[FLASH_STORE_MAX_VALUE];
+	// Copy live values forward to head
+	for (uint8_t key = 0; key < MY_FLASH_STORE_KEYS; key++) {
+		if (_index[key] >= start && _index[key] < end) {
+			uint8_t len;
+			read(key, buf, sizeof(buf), &len);
+			appendRecord(key, buf, len);
+		}
+	}
+	// Unread history in this sector is dropped
+	if (_logAddr >= start && _logAddr < end)
+		_logAddr = nextLog(sectorAddr((sector + 1) % _sectors) + FLASH_STORE_HEADER_SIZE);
+	// Invalidate sector, it is erased when it becomes head again
+	_flash.writeByte(start, 0);
+}
+
+bool MyFlashStore::appendRecord(uint8_t key, const void* data, uint8_t len) {
+	if (_writeAddr + FLASH_STORE_RECORD_HEADER_SIZE + len > sectorAddr(_head) + FLASH_STORE_SECTOR_SIZE) {
+		// Head is full. Move on to the free sector and make the oldest one free.
+		uint8_t next = (_head + 1) % _sectors;
+		openSector(next);
+		recycleSector((next + 1) % _sectors);
+	}
+	uint32_t addr = _writeAddr;
+	uint8_t hdr[2] = {key, len};
+	_flash.writeBytes(addr + 1, hdr, 2);
+	_flash.writeBytes(addr + FLASH_STORE_RECORD_HEADER_SIZE, data, len);
+	// Commit record now that everything is in place
+	_flash.writeByte(addr, FLASH_STORE_COMMITTED);
+	_writeAddr = addr + FLASH_STORE_RECORD_HEADER_SIZE + len;
+
+	if (key < MY_FLASH_STORE_KEYS)
+		_index[key] = addr;
+	else if (_logAddr == FLASH_STORE_NONE)
+		_logAddr = addr;
+	return true;
+}
+
+bool MyFlashStore::write(uint8_t key, const void* data, uint8_t len) {
+	if (key >= MY_FLASH_STORE_KEYS || len > FLASH_STORE_MAX_VALUE)
+		return false;
+	if (_index[key] != FLASH_STORE_NONE && _flash.readByte(_index[key] + 2) == len) {
+		// Skip write if value is unchanged (saves flash wear)
+		uint8_t buf[16];
+		const uint8_t *p = (const uint8_t *)data;
+		uint8_t i = 0;
+		while (i < len) {
+			uint8_t n = min(len - i, (uint8_t)sizeof(buf));
+			_flash.readBytes(_index[key] + FLASH_STORE_RECORD_HEADER_SIZE + i, buf, n);
+			if (memcmp(buf, p + i, n))
+				break;
+			i += n;
+		}
+		if (i >= len)
+			return true;
+	}
+	return appendRecord(key, data, len);
+}
+
+bool MyFlashStore::read(uint8_t key, void* data, uint8_t maxLen, uint8_t *len) {
+	if (key >= MY_FLASH_STORE_KEYS || _index[key] == FLASH_STORE_NONE)
+		return false;
+	*len = _flash.readByte(_index[key] + 2);
+	_flash.readBytes(_index[key] + FLASH_STORE_RECORD_HEADER_SIZE, data, min(*len, maxLen));
+	return true;
+}
+
+bool MyFlashStore::append(const void* data, uint8_t len) {
+	// Larger records might not fit a sector next to the live values
+	if (len > FLASH_STORE_MAX_VALUE)
+		return false;
+	return appendRecord(FLASH_STORE_LOG_KEY, data, len);
+}
+
+bool MyFlashStore::readLog(void* data, uint8_t maxLen, uint8_t *len) {
+	if (_logAddr == FLASH_STORE_NONE)
+		return false;
+	*len = _flash.readByte(_logAddr + 2);
+	_flash.readBytes(_logAddr + FLASH_STORE_RECORD_HEADER_SIZE, data, min(*len, maxLen));
+	return true;
+}
+
+void MyFlashStore::popLog() {
+	if (_logAddr == FLASH_STORE_NONE)
+		return;
+	uint8_t len = _flash.readByte(_logAddr + 2);
+	_flash.writeByte(_logAddr, FLASH_STORE_CONSUMED);
+	_logAddr = nextLog(_logAddr + FLASH_STORE_RECORD_HEADER_SIZE + len);
+}
@@ -0,0 +1,123 @@
+/**
+ * The MySensors Arduino library handles the wireless radio link and protocol
+ * between your home built sensors/actuators and HA controller of choice.
+ * The sensors forms a self healing radio network with optional repeaters. Each
+ * repeater and gateway builds a routing tables in EEPROM which keeps track of the
+ * network topology allowing messages to be routed to nodes.
+ *
+ * Created by Henrik Ekblad <henrik.ekblad@mysensors.org>
+ * Copyright (C) 2013-2015 Sensnology AB
+ * Full contributor list: https://github.com/mysensors/Arduino/graphs/contributors
+ *
+ * Documentation: http://www.mysensors.org
+ * Support Forum: http://forum.mysensors.org
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * version 2 as published by the Free Software Foundation.
+ */
+
+#ifndef MyFlashStore_h
+#define MyFlashStore_h
+
+#include "MyConfig.h"
+#include <stdint.h>
+#include "utility/SPIFlash.h"
+
+// Size of the smallest erasable unit used by the store
+#define FLASH_STORE_SECTOR_SIZE 4096
+
+// Key used for history (log) records
+#define FLASH_STORE_LOG_KEY 0xFE
+
+// Maximum length of a value stored with write() or a history record stored with append()
+#define FLASH_STORE_MAX_VALUE 32
+
+/**
+ * Append-only, wear levelled storage on external SPI flash.
+ *
+ * Records are appended to a ring of 4K sectors. Each record is committed by
+ * programming its state byte after the data has been written, so a write torn
+ * by a power loss is ignored at the next begin(). When the ring wraps, the
+ * latest value of every key found in the oldest sector is copied forward before
+ * that sector is reused. History records in it are dropped (oldest first).
+ *
+ * Two kinds of records are supported:
+ *  - values (write()/read()) for hot state such as pulse counters. Only the
+ *    latest record of each key is kept alive.
+ *  - history (append()/readLog()/popLog()) for buffering readings, e.g. while the
+ *    gateway is unreachable. Records are read back oldest first.
+ */
+class MyFlashStore
+{
+public:
+	/**
+	 * @param flash Flash chip to use. Can be shared with the OTA feature, the store then lies
+	 *        above the MY_OTA_FLASH_SIZE bytes reserved for the firmware image.
+	 * @param start Flash address of first sector (4K aligned, at or after MY_OTA_FLASH_SIZE)
+	 * @param sectors Number of 4K sectors used (minimum 2)
+	 */
+	MyFlashStore(SPIFlash &flash, uint32_t start=MY_FLASH_STORE_START, uint8_t sectors=MY_FLASH_STORE_SECTORS);
+
+	/**
+	 * Initializes flash, recovers the store and rebuilds the RAM index.
+	 * Formats the region if no valid store is found.
+	 * @return false if flash could not be initialized or start is invalid (the store
+	 *         must not be used then)
+	 */
+	bool begin();
+
+	/**
+	 * Stores a value. Nothing is written if the value is unchanged.
+	 * @param key 0 - MY_FLASH_STORE_KEYS-1
+	 * @param len 0 - FLASH_STORE_MAX_VALUE
+	 * @return false if key or length is invalid
+	 */
+	bool write(uint8_t key, const void* data, uint8_t len);
+
+	/**
+	 * Fetches the latest value of key. At most maxLen bytes are copied.
+	 * @param len Set to the length of the stored value (can be 0)
+	 * @return false if key is invalid or has no value
+	 */
+	bool read(uint8_t key, void* data, uint8_t maxLen, uint8_t *len);
+
+	/**
+	 * Appends a history record.
+	 * @param len 0 - FLASH_STORE_MAX_VALUE
+	 * @return false if length is invalid
+	 */
+	bool append(const void* data, uint8_t len);
+
+	/**
+	 * Fetches the oldest history record without removing it. At most maxLen bytes are copied.
+	 * @param len Set to the length of the record (can be 0)
+	 * @return false if log is empty
+	 */
+	bool readLog(void* data, uint8_t maxLen, uint8_t *len);
+
+	/**
+	 * Removes the oldest history record (e.g. after it has been delivered).
+	 */
+	void popLog();
+
+private:
+	SPIFlash& _flash;
+	uint32_t _start;
+	uint8_t _sectors;
+	uint8_t _head; // Sector currently appended to
+	uint16_t _seq; // Sequence number of head sector
+	uint32_t _writeAddr; // Next free address in head sector
+	uint32_t _logAddr; // Oldest unread history record (or _writeAddr)
+	uint32_t _index[MY_FLASH_STORE_KEYS]; // Address of latest record for each key
+
+	uint32_t sectorAddr(uint8_t sector);
+	bool sectorHeader(uint8_t sector, uint16_t *seq);
+	uint32_t scanSector(uint8_t sector);
+	uint32_t nextLog(uint32_t addr);
+	bool appendRecord(uint8_t key, const void* data, uint8_t len);
+	void openSector(uint8_t sector);
+	void recycleSector(uint8_t sector);
+};
+
+#endif
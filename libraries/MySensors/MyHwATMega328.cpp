@@ -188,7 +188,11 @@ inline uint8_t MyHwATMega328::sleep(uint8_t interrupt1, uint8_t mode1, uint8_t i
 	return retVal;
 }
 
-
+uint16_t hw_freeRam() {
+	extern int __heap_start, *__brkval;
+	int v;
+	return (size_t)&v - (__brkval == 0 ? (size_t)&__heap_start : (size_t)__brkval);
+}
 
 #ifdef DEBUG
 void MyHwATMega328::debugPrint(bool isGW, const char *fmt, ... ) {
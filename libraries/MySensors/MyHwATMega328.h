@@ -65,6 +65,7 @@ do { 																\
 #define hw_watchdogReset() wdt_reset()
 #define hw_reboot() wdt_enable(WDTO_15MS); while (1)
 #define hw_millis() millis()
+#define hw_micros() micros()
 #define hw_readConfig(__pos) (eeprom_read_byte((uint8_t*)(__pos)))
 
 #ifndef eeprom_update_byte
@@ -77,6 +78,9 @@ do { 																\
 #define hw_readConfigBlock(__buf, __pos, __length) (eeprom_read_block((__buf), (void*)(__pos), (__length)))
 #define hw_writeConfigBlock(__pos, __buf, __length) (eeprom_write_block((void*)(__pos), (void*)__buf, (__length)))
 
+// Bytes free between heap and stack
+uint16_t hw_freeRam();
+
 
 
 enum period_t
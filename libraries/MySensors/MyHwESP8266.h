@@ -39,6 +39,8 @@
 #define hw_watchdogReset() wdt_reset()
 #define hw_reboot() wdt_enable(WDTO_15MS); while (1)
 #define hw_millis() millis()
+#define hw_micros() micros()
+#define hw_freeRam() ESP.getFreeHeap()
 
 void hw_readConfigBlock(void* buf, void* adr, size_t length);
 void hw_writeConfigBlock(void* buf, void* adr, size_t length);
@@ -0,0 +1,125 @@
+/**
+ * The MySensors Arduino library handles the wireless radio link and protocol
+ * between your home built sensors/actuators and HA controller of choice.
+ * The sensors forms a self healing radio network with optional repeaters. Each
+ * repeater and gateway builds a routing tables in EEPROM which keeps track of the
+ * network topology allowing messages to be routed to nodes.
+ *
+ * Created by Henrik Ekblad <henrik.ekblad@mysensors.org>
+ * Copyright (C) 2013-2015 Sensnology AB
+ * Full contributor list: https://github.com/mysensors/Arduino/graphs/contributors
+ *
+ * Documentation: http://www.mysensors.org
+ * Support Forum: http://forum.mysensors.org
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * version 2 as published by the Free Software Foundation.
+ */
+
+#ifdef __linux__
+
+#include "MyHw.h"
+#include "MyHwLinux.h"
+#include <stdio.h>
+#include <stdarg.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+static uint8_t eeprom[MY_LINUX_EEPROM_SIZE];
+static bool eepromInit = false;
+
+static uint8_t* hw_eeprom(void* adr, size_t length)
+{
+	if (!eepromInit) {
+		memset(eeprom, 0xFF, sizeof(eeprom));
+		eepromInit = true;
+	}
+	size_t offs = (size_t)adr;
+	if (offs + length > MY_LINUX_EEPROM_SIZE)
+		return NULL;
+	return eeprom + offs;
+}
+
+unsigned long hw_millis()
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (unsigned long)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+unsigned long hw_micros()
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (unsigned long)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+void hw_readConfigBlock(void* buf, void* adr, size_t length)
+{
+	uint8_t* src = hw_eeprom(adr, length);
+	if (src)
+		memcpy(buf, src, length);
+	else
+		memset(buf, 0xFF, length);
+}
+
+void hw_writeConfigBlock(void* buf, void* adr, size_t length)
+{
+	uint8_t* dst = hw_eeprom(adr, length);
+	if (dst)
+		memcpy(dst, buf, length);
+}
+
+uint8_t hw_readConfig(int adr)
+{
+	uint8_t value;
+	hw_readConfigBlock(&value, (void*)(size_t)adr, 1);
+	return value;
+}
+
+void hw_writeConfig(int adr, uint8_t value)
+{
+	hw_writeConfigBlock(&value, (void*)(size_t)adr, 1);
+}
+
+
+MyHwLinux::MyHwLinux() : MyHw()
+{
+}
+
+void MyHwLinux::sleep(unsigned long ms) {
+	usleep(ms * 1000);
+}
+
+bool MyHwLinux::sleep(uint8_t interrupt, uint8_t mode, unsigned long ms) {
+	(void)interrupt;
+	(void)mode;
+	sleep(ms);
+	return false;
+}
+
+uint8_t MyHwLinux::sleep(uint8_t interrupt1, uint8_t mode1, uint8_t interrupt2, uint8_t mode2, unsigned long ms) {
+	(void)interrupt1;
+	(void)mode1;
+	(void)interrupt2;
+	(void)mode2;
+	sleep(ms);
+	return -1;
+}
+
+#ifdef DEBUG
+void MyHwLinux::debugPrint(bool isGW, const char *fmt, ... ) {
+	if (isGW) {
+		// prepend debug message to be handled correctly by controller (C_INTERNAL, I_LOG_MESSAGE)
+		fprintf(stderr, "0;0;%d;0;%d;", C_INTERNAL, I_LOG_MESSAGE);
+	}
+	va_list args;
+	va_start(args, fmt);
+	vfprintf(stderr, fmt, args);
+	va_end(args);
+}
+#endif
+
+#endif // #ifdef __linux__
@@ -0,0 +1,83 @@
+/**
+ * The MySensors Arduino library handles the wireless radio link and protocol
+ * between your home built sensors/actuators and HA controller of choice.
+ * The sensors forms a self healing radio network with optional repeaters. Each
+ * repeater and gateway builds a routing tables in EEPROM which keeps track of the
+ * network topology allowing messages to be routed to nodes.
+ *
+ * Created by Henrik Ekblad <henrik.ekblad@mysensors.org>
+ * Copyright (C) 2013-2015 Sensnology AB
+ * Full contributor list: https://github.com/mysensors/Arduino/graphs/contributors
+ *
+ * Documentation: http://www.mysensors.org
+ * Support Forum: http://forum.mysensors.org
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * version 2 as published by the Free Software Foundation.
+ */
+
+#ifdef __linux__
+
+#ifndef MyHwLinux_h
+#define MyHwLinux_h
+
+#include "MyHw.h"
+#include "MyConfig.h"
+#include "MyMessage.h"
+#include <stdlib.h>
+
+// Linux host (software nodes, benchmarks). Needs an Arduino.h shim on the include path,
+// see Benchmark/host. EEPROM is emulated in RAM and starts out erased (0xFF).
+
+// Size of the emulated EEPROM
+#define MY_LINUX_EEPROM_SIZE 1024
+
+// Define these as macros to save valuable space
+
+#define hw_digitalWrite(__pin, __value)
+#define hw_init()
+#define hw_watchdogReset()
+#define hw_reboot() exit(0)
+
+unsigned long hw_millis();
+unsigned long hw_micros();
+// Not meaningful on a host
+#define hw_freeRam() 0
+void hw_readConfigBlock(void* buf, void* adr, size_t length);
+void hw_writeConfigBlock(void* buf, void* adr, size_t length);
+void hw_writeConfig(int adr, uint8_t value);
+uint8_t hw_readConfig(int adr);
+
+enum period_t
+{
+	SLEEP_15Ms,
+	SLEEP_30MS,
+	SLEEP_60MS,
+	SLEEP_120MS,
+	SLEEP_250MS,
+	SLEEP_500MS,
+	SLEEP_1S,
+	SLEEP_2S,
+	SLEEP_4S,
+	SLEEP_8S,
+	SLEEP_FOREVER
+};
+
+class MyHwLinux : public MyHw
+{ 
+public:
+	MyHwLinux();
+
+	// There are no wake up interrupts, sleep() always runs the full time
+	void sleep(unsigned long ms);
+	bool sleep(uint8_t interrupt, uint8_t mode, unsigned long ms);
+	uint8_t sleep(uint8_t interrupt1, uint8_t mode1, uint8_t interrupt2, uint8_t mode2, unsigned long ms);
+#ifdef DEBUG
+	// Written to stderr, so stdout stays free for the application (e.g. serial gateway protocol)
+	void debugPrint(bool isGW, const char *fmt, ... );
+#endif
+};
+#endif
+
+#endif // #ifdef __linux__
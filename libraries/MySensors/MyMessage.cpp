@@ -79,6 +79,90 @@ char* MyMessage::getStream(char *buffer) const {
 	}
 }
 
+// Writes value in decimal, returns the end of the string.
+// Division by 10 (not the generic radix versions of ultoa) and only 16 bit division as soon as the
+// value fits, 32 bit division is slow on 8 bit processors.
+static char* formatULong(char *buffer, unsigned long value, uint8_t minDigits = 1) {
+	char digits[sizeof(unsigned long) * 5 / 2]; // 10 for 32 bit
+	uint8_t n = 0;
+	while (value > 0xFFFF) {
+		unsigned long q = value / 10;
+		digits[n++] = '0' + (uint8_t)(value - q * 10);
+		value = q;
+	}
+	uint16_t v = value;
+	do {
+		uint16_t q = v / 10;
+		digits[n++] = '0' + (uint8_t)(v - q * 10);
+		v = q;
+	} while (v);
+	while (n < minDigits)
+		digits[n++] = '0';
+	while (n)
+		*buffer++ = digits[--n];
+	*buffer = 0;
+	return buffer;
+}
+
+static char* formatLong(char *buffer, long value) {
+	if (value < 0) {
+		*buffer++ = '-';
+		return formatULong(buffer, -(unsigned long)value);
+	}
+	return formatULong(buffer, value);
+}
+
+// Same output as dtostrf(value, 2, decimals, buffer), but without the soft float formatting.
+// The fraction is converted to 4.28 fixed point (scaling by a power of 2) and the digits
+// are produced with integer multiplications by 10. Rounds half away from zero. Falls back to
+// dtostrf for values that don't fit 32 bits (and NaN/infinity).
+static void formatFloat(char *buffer, float value, uint8_t decimals) {
+	bool negative = value < 0;
+	if (negative)
+		value = -value;
+	if (decimals > 9 || !(value < 4294967040.0f)) { // Largest float below 2^32
+		dtostrf(negative ? -value : value, 2, decimals, buffer);
+		return;
+	}
+	unsigned long integer = value;
+	uint32_t fraction = (value - integer) * 268435456.0f + 0.5f; // 2^28
+	if (fraction > 0x0FFFFFFF) {
+		// Fraction rounded up to 1
+		integer++;
+		fraction = 0;
+	}
+	char digits[9];
+	for (uint8_t i = 0; i < decimals; i++) {
+		fraction *= 10;
+		digits[i] = '0' + (uint8_t)(fraction >> 28);
+		fraction &= 0x0FFFFFFF;
+	}
+	if (fraction >= 0x08000000) {
+		// Round up, carry into the integer part if all digits are 9
+		int8_t i = decimals - 1;
+		while (i >= 0 && digits[i] == '9')
+			digits[i--] = '0';
+		if (i >= 0)
+			digits[i]++;
+		else
+			integer++;
+	}
+	char *p = buffer;
+	if (negative)
+		*p++ = '-';
+	p = formatULong(p, integer);
+	if (decimals) {
+		*p++ = '.';
+		memcpy(p, digits, decimals);
+		p[decimals] = 0;
+	} else if (p - buffer < 2) {
+		// dtostrf pads to a width of 2
+		buffer[1] = buffer[0];
+		buffer[0] = ' ';
+		buffer[2] = 0;
+	}
+}
+
 char* MyMessage::getString(char *buffer) const {
 	uint8_t payloadType = miGetPayloadType();
 	if (buffer != NULL) {
@@ -86,17 +170,17 @@ char* MyMessage::getString(char *buffer) const {
 			strncpy(buffer, data, miGetLength());
 			buffer[miGetLength()] = 0;
 		} else if (payloadType == P_BYTE) {
-			itoa(bValue, buffer, 10);
+			formatULong(buffer, bValue);
 		} else if (payloadType == P_INT16) {
-			itoa(iValue, buffer, 10);
+			formatLong(buffer, iValue);
 		} else if (payloadType == P_UINT16) {
-			utoa(uiValue, buffer, 10);
+			formatULong(buffer, uiValue);
 		} else if (payloadType == P_LONG32) {
-			ltoa(lValue, buffer, 10);
+			formatLong(buffer, lValue);
 		} else if (payloadType == P_ULONG32) {
-			ultoa(ulValue, buffer, 10);
+			formatULong(buffer, ulValue);
 		} else if (payloadType == P_FLOAT32) {
-			dtostrf(fValue,2,fPrecision,buffer);
+			formatFloat(buffer, fValue, fPrecision);
 		} else if (payloadType == P_CUSTOM) {
 			return getCustomString(buffer);
 		}
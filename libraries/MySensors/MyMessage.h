@@ -26,11 +26,19 @@
 #include <string.h>
 #include <stdint.h>
 #endif
+#include "MyConfig.h"
 
 #define PROTOCOL_VERSION 2
-#define MAX_MESSAGE_LENGTH 32
+#define MAX_MESSAGE_LENGTH MY_MAX_MESSAGE_LENGTH
 #define HEADER_SIZE 7
 #define MAX_PAYLOAD (MAX_MESSAGE_LENGTH - HEADER_SIZE)
+// Signed messages (nonce, payload + signature) always use the 32 byte frame every radio can carry
+#define SIGNED_MESSAGE_LENGTH 32
+#define SIGNED_PAYLOAD (SIGNED_MESSAGE_LENGTH - HEADER_SIZE)
+
+#if MAX_PAYLOAD > 31 || MAX_MESSAGE_LENGTH < SIGNED_MESSAGE_LENGTH
+#error MY_MAX_MESSAGE_LENGTH must be 32-38
+#endif
 
 // Message types
 typedef enum {
@@ -151,7 +159,7 @@ typedef enum {
 	I_INCLUSION_MODE, I_CONFIG, I_FIND_PARENT, I_FIND_PARENT_RESPONSE,
 	I_LOG_MESSAGE, I_CHILDREN, I_SKETCH_NAME, I_SKETCH_VERSION,
 	I_REBOOT, I_GATEWAY_READY, I_REQUEST_SIGNING, I_GET_NONCE, I_GET_NONCE_RESPONSE,
-	I_HEARTBEAT
+	I_HEARTBEAT, I_CHANNEL_SURVEY, I_CHANNEL_CHANGE, I_STATS, I_SLOT, I_NODE_TABLE
 } mysensor_internal;
 
 
@@ -318,4 +326,78 @@ uint8_t array[HEADER_SIZE + MAX_PAYLOAD + 1];
 } __attribute__((packed)) MyMessage;
 #endif
 
+#ifdef __cplusplus
+// Value type and length of the fixed size payload types, used by MyTypedMessage
+template <uint8_t payloadType> struct MyPayloadTraits;
+template <> struct MyPayloadTraits<P_BYTE> {
+	typedef uint8_t value_type;
+	static void store(MyMessage &msg, value_type value, uint8_t) { msg.bValue = value; }
+	enum { length = 1 };
+};
+template <> struct MyPayloadTraits<P_INT16> {
+	typedef int value_type;
+	static void store(MyMessage &msg, value_type value, uint8_t) { msg.iValue = value; }
+	enum { length = 2 };
+};
+template <> struct MyPayloadTraits<P_UINT16> {
+	typedef unsigned int value_type;
+	static void store(MyMessage &msg, value_type value, uint8_t) { msg.uiValue = value; }
+	enum { length = 2 };
+};
+template <> struct MyPayloadTraits<P_LONG32> {
+	typedef long value_type;
+	static void store(MyMessage &msg, value_type value, uint8_t) { msg.lValue = value; }
+	enum { length = 4 };
+};
+template <> struct MyPayloadTraits<P_ULONG32> {
+	typedef unsigned long value_type;
+	static void store(MyMessage &msg, value_type value, uint8_t) { msg.ulValue = value; }
+	enum { length = 4 };
+};
+template <> struct MyPayloadTraits<P_FLOAT32> {
+	typedef float value_type;
+	static void store(MyMessage &msg, value_type value, uint8_t decimals) { msg.fValue = value; msg.fPrecision = decimals; }
+	enum { length = 5 }; // 32 bit float + precision
+};
+
+/**
+ * Message builder with everything but the addresses and the value fixed at compile time.
+ * The header bytes are constants, so building a message is a handful of byte stores instead of
+ * the read-modify-write of each field done by the mSetXxx() macros and set().
+ *
+ *   MyMessage msg;
+ *   typedef MyTypedMessage<CHILD_ID_TEMP, V_TEMP, P_FLOAT32> TempMessage;
+ *   gw.sendRoute(TempMessage::build(msg, gw.getNodeId(), GATEWAY_ADDRESS, temperature, 1));
+ *
+ * Use sendRoute(), send() would set the command and ack flag again at runtime.
+ * Only the fixed size payload types are supported, use set() for P_STRING and P_CUSTOM.
+ */
+template <uint8_t sensor, uint8_t type, uint8_t payloadType, uint8_t command = C_SET, bool requestAck = false>
+class MyTypedMessage
+{
+public:
+	typedef MyPayloadTraits<payloadType> Traits;
+	typedef typename Traits::value_type value_type;
+
+	enum {
+		versionLength = PROTOCOL_VERSION | (Traits::length << 3), // Unsigned
+		commandAckPayload = command | (requestAck << 3) | (payloadType << 5) // Not an ack
+	};
+
+	/**
+	 * @param decimals Number of decimals when serializing (P_FLOAT32 only)
+	 */
+	static inline MyMessage& build(MyMessage &msg, uint8_t sender, uint8_t destination, value_type value, uint8_t decimals = 0) {
+		msg.sender = sender;
+		msg.destination = destination;
+		msg.version_length = versionLength;
+		msg.command_ack_payload = commandAckPayload;
+		msg.type = type;
+		msg.sensor = sensor;
+		Traits::store(msg, value, decimals);
+		return msg;
+	}
+};
+#endif
+
 #endif
@@ -41,6 +41,43 @@ static inline MyMessage& build (MyMessage &msg, uint8_t sender, uint8_t destinat
 	return msg;
 }
 
+#ifdef MY_SLOTS
+// Time until the slot of node starts, by the clock of the gateway
+static inline unsigned long slotOffset(uint8_t node) {
+	unsigned long start = (node % MY_SLOT_COUNT) * (MY_SLOT_PERIOD / MY_SLOT_COUNT);
+	unsigned long pos = hw_millis() % MY_SLOT_PERIOD;
+	return start >= pos ? start - pos : start + MY_SLOT_PERIOD - pos;
+}
+#endif
+
+// Messages handed to the radio at once by sendBatch()
+#define BATCH_FRAMES 8
+
+#ifdef MY_E2E_ACK_FEATURE
+// Message ids are reserved in EEPROM in blocks of this size
+#define E2E_ID_BLOCK 32
+// Ids run from 1 to E2E_ID_MAX. 0 means no id, 0xFF is erased EEPROM (no reservation).
+#define E2E_ID_MAX 0xFE
+// Longest time a sender retransmits a message (see sendReliable())
+#define E2E_DUPLICATE_TIMEOUT ((MY_E2E_RETRIES + 1) * (unsigned long)MY_E2E_MAX_RTO)
+#endif
+
+#ifdef MY_OTA_FIRMWARE_FEATURE
+// Longest time to wait for the flash to finish earlier work before erasing it for an update
+#define FLASH_IDLE_TIMEOUT 1000
+#endif
+
+#ifdef MY_EEPROM_JOURNAL
+// Journal record: sequence number, position, value
+#define JOURNAL_RECORD_ADDRESS(slot) (EEPROM_JOURNAL_ADDRESS + (slot) * 3)
+#define JOURNAL_SEQ_INVALID 0xFF
+
+static inline uint8_t journalNextSeq(uint8_t seq) {
+	// 0xFF (erased EEPROM) is never used as sequence number
+	return seq >= 0xFE ? 0 : seq + 1;
+}
+#endif
+
 static inline bool isValidParent( const uint8_t parent ) {
 	return parent != AUTO;
 }
@@ -73,24 +110,65 @@ MySensor::MySensor(MyTransport &_radio, MyHw &_hw
 }
 
 
-#ifdef MY_OTA_FIRMWARE_FEATURE
-
-// do a crc16 on the whole received firmware
-bool MySensor::isValidFirmware() {		
-	// init crc
-	uint16_t crc = ~0;
-	for (uint16_t i = 0; i < fc.blocks * FIRMWARE_BLOCK_SIZE; ++i) {
-		crc ^= flash.readByte(i + FIRMWARE_START_OFFSET);
+uint16_t MySensor::crc16(uint16_t crc, const void* data, uint16_t len) {
+	const uint8_t* p = (const uint8_t*)data;
+	while (len--) {
+		crc ^= *p++;
 	    for (int8_t j = 0; j < 8; ++j) {
 	        if (crc & 1)
 	            crc = (crc >> 1) ^ 0xA001;
 	        else
 	            crc = (crc >> 1);
 	    }
+	}
+	return crc;
+}
+
+#ifdef MY_OTA_FIRMWARE_FEATURE
+
+// do a crc16 on the whole received firmware
+bool MySensor::isValidFirmware() {		
+	// init crc
+	uint16_t crc = ~0;
+	uint8_t block[FIRMWARE_BLOCK_SIZE];
+	for (uint16_t i = 0; i < fc.blocks; ++i) {
+		// One flash read command per block instead of per byte
+		flash.readBytes((uint32_t)i * FIRMWARE_BLOCK_SIZE + FIRMWARE_START_OFFSET, block, FIRMWARE_BLOCK_SIZE);
+		crc = crc16(crc, block, FIRMWARE_BLOCK_SIZE);
 	}	
 	return crc == fc.crc; 
 }
 
+void MySensor::processFirmwareFlash() {
+	if (!fwUpdateOngoing || !flash.poll())
+		return; // Nothing to do or flash still busy erasing/writing
+	if (fwFlashing) {
+		// Block at head has been written, release its slot
+		fwFlashing = false;
+		fwBufferHead = (fwBufferHead + 1) % MY_OTA_BUFFERED_BLOCKS;
+		fwBufferCount--;
+	}
+	if (fwBufferCount) {
+		flash.submitWrite((fwBufferBlock[fwBufferHead] * FIRMWARE_BLOCK_SIZE) + FIRMWARE_START_OFFSET, fwBuffer[fwBufferHead], FIRMWARE_BLOCK_SIZE);
+		fwFlashing = true;
+	} else if (!fwBlock) {
+		// We're finished! Do a checksum and reboot.
+		fwUpdateOngoing = false;
+		if (isValidFirmware()) {
+			debug(PSTR("fw checksum ok\n"));
+			// All seems ok, write size and signature to flash (DualOptiboot will pick this up and flash it)	
+			uint16_t fwsize = FIRMWARE_BLOCK_SIZE * fc.blocks;
+			uint8_t OTAbuffer[10] = {'F','L','X','I','M','G',':',(uint8_t)(fwsize >> 8),(uint8_t)(fwsize & 0xff),':'};
+			flash.writeBytes(0, OTAbuffer, 10);
+			// Write the new firmware config to eeprom
+			hw_writeConfigBlock((void*)&fc, (void*)EEPROM_FIRMWARE_TYPE_ADDRESS, sizeof(NodeFirmwareConfig));
+			hw_reboot();
+		} else {
+			debug(PSTR("fw checksum fail\n"));
+		}
+	}
+}
+
 #endif
 
 #ifdef WITH_LEDS_BLINKING
@@ -157,6 +235,42 @@ void MySensor::begin(void (*_msgCallback)(const MyMessage &), uint8_t _nodeId, b
 	repeaterMode = _repeaterMode;
 	msgCallback = _msgCallback;
 	failedTransmissions = 0;
+#ifdef MY_TRACE
+	traceHead = 0;
+	traceCount = 0;
+#endif
+#ifdef MY_E2E_ACK_FEATURE
+	msgId = 0;
+	// Continue after the ids reserved before the last reboot, receivers may still remember those
+	nextMsgId = hw_readConfig(EEPROM_MSG_ID_ADDRESS);
+	if (nextMsgId == 0 || nextMsgId > E2E_ID_MAX)
+		nextMsgId = 0; // Erased EEPROM, no reservation yet
+	reserveMsgIds();
+	txMsgId = 0;
+	e2eWait = NULL;
+	for (uint8_t i = 0; i < MY_E2E_DESTINATIONS; i++)
+		rtt[i].node = AUTO;
+	memset(dupId, 0, sizeof(dupId));
+	dupNext = 0;
+#endif
+#ifdef MY_NODE_TABLE
+	for (uint8_t i = 0; i < MY_NODE_TABLE_SIZE; i++)
+		nodeTable[i].nodeId = AUTO;
+	nodeTableCheck = 0;
+#endif
+#ifdef MY_SLOTS
+	slotSynced = false;
+	slotRate = 1.0f;
+	slotSlept = 0;
+	slotCycles = 0;
+#endif
+#ifdef MY_NODE_STATS
+	memset(&stats, 0, sizeof(stats));
+	processUs = 0;
+#endif
+#ifdef MY_OTA_FIRMWARE_FEATURE
+	fwUpdateOngoing = false;
+#endif
 
 	// Only gateway should use node id 0!
 	isGateway = _nodeId == GATEWAY_ADDRESS;
@@ -166,6 +280,16 @@ void MySensor::begin(void (*_msgCallback)(const MyMessage &), uint8_t _nodeId, b
 		debug(PSTR("radio init fail\n"));
 		while(1); // Nothing more we can do
 	}
+	// Use the channel the gateway moved the network to
+	uint8_t channel = hw_readConfig(EEPROM_RADIO_CHANNEL_ADDRESS);
+	if (channel != 0xFF)
+		radio.setChannel(channel);
+	failedSearches = 0;
+	channelStep = 0;
+
+#ifdef MY_EEPROM_JOURNAL
+	loadJournal();
+#endif
 
 #ifdef MY_SIGNING_FEATURE
 	// Read out the signing requirements from EEPROM
@@ -276,7 +400,7 @@ void MySensor::setupNode() {
 		// Send a configuration exchange request to controller
 		// Node sends parent node. Controller answers with latest node configuration
 		// which is picked up in process()
-		sendRoute(build(msg, nc.nodeId, GATEWAY_ADDRESS, NODE_SENSOR_ID, C_INTERNAL, I_CONFIG, false).set(nc.parentNodeId));
+		sendRoute(MyTypedMessage<NODE_SENSOR_ID, I_CONFIG, P_BYTE, C_INTERNAL>::build(msg, nc.nodeId, GATEWAY_ADDRESS, nc.parentNodeId));
 
 		// Wait configuration reply.
 		wait(2000);
@@ -320,6 +444,34 @@ void MySensor::findParentNode() {
 	// Wait for ping response.
 	wait(2000);
 	findingParentNode = false;
+
+	if (nc.distance != DISTANCE_INVALID) {
+		failedSearches = 0;
+		if (channelStep) {
+			// Found the network on another channel, stay there
+			hw_writeConfig(EEPROM_RADIO_CHANNEL_ADDRESS, fallbackChannel(channelStep));
+			channelStep = 0;
+		}
+	} else if (++failedSearches >= CHANNEL_FALLBACK_SEARCHES) {
+		// We might have missed channel changes, try the next candidate
+		failedSearches = 0;
+		if (!radio.setChannel(fallbackChannel(++channelStep))) {
+			// Past the last channel of the radio (or no channel support), start over
+			channelStep = 0;
+			radio.setChannel(fallbackChannel(0));
+		}
+		debug(PSTR("try channel=%d\n"), fallbackChannel(channelStep));
+	}
+}
+
+// Channels tried when no parent answers: the stored one, the default one of the radio,
+// then every channel in turn
+uint8_t MySensor::fallbackChannel(uint8_t step) {
+	if (step == 0)
+		return hw_readConfig(EEPROM_RADIO_CHANNEL_ADDRESS); // 0xFF (erased) is CHANNEL_DEFAULT
+	if (step == 1)
+		return CHANNEL_DEFAULT;
+	return step - 2;
 }
 
 boolean MySensor::sendRoute(MyMessage &message) {
@@ -348,6 +500,13 @@ boolean MySensor::sendRoute(MyMessage &message) {
 
 	mSetVersion(message, PROTOCOL_VERSION);
 
+#ifdef MY_E2E_ACK_FEATURE
+	if (sender == nc.nodeId && mGetRequestAck(message) && !mGetAck(message)) {
+		// Message id goes after the payload, only sendReliable() messages get one
+		message.data[mGetLength(message)] = txMsgId;
+	}
+#endif
+
 #ifdef MY_SIGNING_FEATURE
 	// If destination is known to require signed messages and we are the sender, sign this message unless it is an ACK or a handshake message
 	if (DO_SIGN(message.destination) && message.sender == nc.nodeId && !mGetAck(message) && mGetLength(message) &&
@@ -379,6 +538,7 @@ boolean MySensor::sendRoute(MyMessage &message) {
 		}
 		if (hw_millis() - enter > MY_VERIFICATION_TIMEOUT_MS) {
 			debug(PSTR("nonce tmo\n"));
+			countStat(signFail);
 #ifdef WITH_LEDS_BLINKING
 			errBlink(1);
 #endif
@@ -386,6 +546,7 @@ boolean MySensor::sendRoute(MyMessage &message) {
 		}
 		if (!signOk) {
 			debug(PSTR("sign fail\n"));
+			countStat(signFail);
 #ifdef WITH_LEDS_BLINKING
 			errBlink(1);
 #endif
@@ -420,7 +581,16 @@ boolean MySensor::sendRoute(MyMessage &message) {
 			//
 			// Message destination is not gateway and is in routing table for this node.
 			// Send it downstream
-			return sendWrite(route, message);
+			ok = sendWrite(route, message);
+#ifdef MY_ACK_PAYLOAD_FEATURE
+			if (!ok) {
+				// Child is probably sleeping, it picks the message up with the ACK of its next report
+				uint8_t length = mGetSigned(message) ? SIGNED_MESSAGE_LENGTH : HEADER_SIZE + mGetLength(message);
+				if (radio.preloadAck(route, &message, length))
+					debug(PSTR("ack pl: %d\n"), route);
+			}
+#endif
+			return ok;
 		} else if (sender == GATEWAY_ADDRESS && dest == BROADCAST_ADDRESS) {
 			// Node has not yet received any id. We need to send it
 			// by doing a broadcast sending,
@@ -448,6 +618,11 @@ boolean MySensor::sendRoute(MyMessage &message) {
 		}
 	}
 
+	trackParentFailures(ok);
+	return ok;
+}
+
+void MySensor::trackParentFailures(bool ok) {
 	if (!ok) {
 		// Failure when sending to parent node. The parent node might be down and we
 		// need to find another route to gateway.
@@ -455,29 +630,164 @@ boolean MySensor::sendRoute(MyMessage &message) {
 		errBlink(1);
 #endif
 		failedTransmissions++;
+#ifdef MY_NODE_STATS
+		if (failedTransmissions > stats.failedTransmissionsPeak)
+			stats.failedTransmissionsPeak = failedTransmissions;
+#endif
 		if (autoFindParent && failedTransmissions > SEARCH_FAILURES) {
 			findParentNode();
 		}
 	} else {
 		failedTransmissions = 0;
 	}
+}
+
+boolean MySensor::forward(uint8_t len) {
+	// Relays the frame in msg as received (len bytes, including signature or
+	// message id), only 'last' is changed. Same routes as sendRoute().
+	uint8_t sender = msg.sender;
+	uint8_t dest = msg.destination;
+	uint8_t route = dest == GATEWAY_ADDRESS ? AUTO : hw_readConfig(EEPROM_ROUTES_ADDRESS+dest);
+	bool downstream = route > GATEWAY_ADDRESS && route < BROADCAST_ADDRESS;
+	if (!downstream) {
+		if (isGateway) {
+			// Destination isn't in our routing table
+			return false;
+		}
+		// Towards the gateway, remember the way back to the sender
+		hw_writeConfig(EEPROM_ROUTES_ADDRESS+sender, msg.last);
+		route = nc.parentNodeId;
+	}
+	msg.last = nc.nodeId;
+#ifdef WITH_LEDS_BLINKING
+	txBlink(1);
+#endif
+	bool ok = radio.send(route, &msg, len);
+#ifdef MY_NODE_STATS
+	if (ok)
+		stats.txOk++;
+	else
+		stats.txFail++;
+#endif
+#ifdef MY_TRACE
+	trace(ok ? TRACE_SEND_OK : TRACE_SEND_FAIL, route, msg);
+#else
+	debug(PSTR("fwd: %d-%d-%d-%d,st=%s\n"), sender, msg.last, route, dest, ok ? "ok":"fail");
+#endif
+	if (downstream) {
+#ifdef MY_ACK_PAYLOAD_FEATURE
+		if (!ok && radio.preloadAck(route, &msg, len)) {
+			// Child is probably sleeping, it picks the message up with the ACK of its next report
+			debug(PSTR("ack pl: %d\n"), route);
+		}
+#endif
+	} else {
+		trackParentFailures(ok);
+	}
 	return ok;
 }
 
 boolean MySensor::sendWrite(uint8_t to, MyMessage &message) {
 	mSetVersion(message, PROTOCOL_VERSION);
-	uint8_t length = mGetSigned(message) ? MAX_MESSAGE_LENGTH : mGetLength(message);
+	uint8_t length = mGetSigned(message) ? SIGNED_MESSAGE_LENGTH : HEADER_SIZE + mGetLength(message);
 	message.last = nc.nodeId;
+	if (length > radio.getMTU()) {
+		debug(PSTR("send: l=%d > mtu\n"), mGetLength(message));
+		return false;
+	}
+#ifdef MY_E2E_ACK_FEATURE
+	// Include the message id (see sendRoute()) if there is room
+	if (!mGetSigned(message) && (mGetRequestAck(message) || mGetAck(message)) && length < radio.getMTU())
+		length++;
+#endif
 #ifdef WITH_LEDS_BLINKING
 	txBlink(1);
 #endif
-	bool ok = radio.send(to, &message, min(MAX_MESSAGE_LENGTH, HEADER_SIZE + length));
+	bool ok = radio.send(to, &message, length);
+	logSend(to, message, ok);
+	return ok;
+}
 
+// Statistics and debug output for a packet handed to the radio
+void MySensor::logSend(uint8_t to, MyMessage &message, bool ok) {
+#ifdef MY_NODE_STATS
+	if (to != BROADCAST_ADDRESS) {
+		if (ok)
+			stats.txOk++;
+		else
+			stats.txFail++;
+	}
+#endif
+
+#ifdef MY_TRACE
+	trace(to == BROADCAST_ADDRESS ? TRACE_SEND_BC : (ok ? TRACE_SEND_OK : TRACE_SEND_FAIL), to, message);
+#else
 	debug(PSTR("send: %d-%d-%d-%d s=%d,c=%d,t=%d,pt=%d,l=%d,sg=%d,st=%s:%s\n"),
 			message.sender,message.last, to, message.destination, message.sensor, mGetCommand(message), message.type,
 			mGetPayloadType(message), mGetLength(message), mGetSigned(message), to==BROADCAST_ADDRESS ? "bc" : (ok ? "ok":"fail"), message.getString(convBuf));
+#endif
+}
 
-	return ok;
+uint8_t MySensor::sendBatch(MyMessage *messages, uint8_t count) {
+	MyTransportFrame frames[BATCH_FRAMES];
+	uint8_t sent = 0;
+	while (count) {
+		uint8_t n = 0;
+		for (; count && n < BATCH_FRAMES; messages++, count--) {
+			MyMessage &message = *messages;
+			uint8_t dest = message.destination;
+			bool single = nc.parentNodeId == AUTO || nc.nodeId == AUTO;
+#ifdef MY_SIGNING_FEATURE
+			single |= DO_SIGN(dest) != 0;
+#endif
+#ifdef MY_E2E_ACK_FEATURE
+			single |= mGetRequestAck(message);
+#endif
+			if (single) {
+				if (sendRoute(message))
+					sent++;
+				continue;
+			}
+			// Next hop, as in sendRoute()
+			uint8_t to = nc.parentNodeId;
+			if (dest != GATEWAY_ADDRESS && repeaterMode) {
+				uint8_t route = hw_readConfig(EEPROM_ROUTES_ADDRESS+dest);
+				if (route > GATEWAY_ADDRESS && route < BROADCAST_ADDRESS)
+					to = route;
+				else if (message.sender == GATEWAY_ADDRESS && dest == BROADCAST_ADDRESS)
+					to = BROADCAST_ADDRESS;
+				else if (isGateway)
+					continue; // No route
+			}
+			mSetVersion(message, PROTOCOL_VERSION);
+			mSetSigned(message, 0);
+			message.last = nc.nodeId;
+			uint8_t length = HEADER_SIZE + mGetLength(message);
+			if (length > radio.getMTU())
+				continue;
+			// Keep frames for the same next hop together, the driver pipelines those
+			uint8_t j = n++;
+			while (j && frames[j-1].to > to) {
+				frames[j] = frames[j-1];
+				j--;
+			}
+			frames[j].to = to;
+			frames[j].data = &message;
+			frames[j].len = length;
+		}
+		if (!n)
+			continue;
+#ifdef WITH_LEDS_BLINKING
+		txBlink(1);
+#endif
+		sent += radio.sendBatch(frames, n);
+		for (uint8_t i = 0; i < n; i++) {
+			logSend(frames[i].to, *(MyMessage *)frames[i].data, frames[i].ok);
+			if (frames[i].to == nc.parentNodeId)
+				trackParentFailures(frames[i].ok);
+		}
+	}
+	return sent;
 }
 
 bool MySensor::send(MyMessage &message, bool enableAck) {
@@ -492,10 +802,24 @@ void MySensor::sendBatteryLevel(uint8_t value, bool enableAck) {
 }
 
 void MySensor::sendHeartbeat(void) {
-	sendRoute(build(msg, nc.nodeId, GATEWAY_ADDRESS, NODE_SENSOR_ID, C_INTERNAL, I_HEARTBEAT, false).set(heartbeat++));
+	sendRoute(MyTypedMessage<NODE_SENSOR_ID, I_HEARTBEAT, P_UINT16, C_INTERNAL>::build(msg, nc.nodeId, GATEWAY_ADDRESS, heartbeat++));
+#ifdef MY_NODE_STATS_WITH_HEARTBEAT
+	sendStats();
+#endif
+}
 
+#ifdef MY_NODE_STATS
+void MySensor::sendStats(void) {
+	stats.freeRam = hw_freeRam();
+	sendRoute(build(msg, nc.nodeId, GATEWAY_ADDRESS, NODE_SENSOR_ID, C_INTERNAL, I_STATS, false).set(&stats, sizeof(NodeStats)));
 }
 
+NodeStats MySensor::getStats() {
+	stats.freeRam = hw_freeRam();
+	return stats;
+}
+#endif
+
 void MySensor::present(uint8_t childSensorId, uint8_t sensorType, const char *description, bool enableAck) {
 	sendRoute(build(msg, nc.nodeId, GATEWAY_ADDRESS, childSensorId, C_PRESENTATION, sensorType, enableAck).set(childSensorId==NODE_SENSOR_ID?LIBRARY_VERSION:description));
 }
@@ -525,12 +849,22 @@ boolean MySensor::process() {
 	handleLedsBlinking();
 #endif
 
+#ifdef MY_OTA_FIRMWARE_FEATURE
+	processFirmwareFlash();
+#endif
+
+#ifdef MY_NODE_TABLE
+	if (isGateway)
+		checkNodeTable();
+#endif
+
 	uint8_t to = 0;
 	if (!radio.available(&to))
 	{
 #ifdef MY_OTA_FIRMWARE_FEATURE
 		unsigned long enter = hw_millis();
-		if (fwUpdateOngoing && (enter - fwLastRequestTime > MY_OTA_RETRY_DELAY)) {
+		// Only request more blocks while there is room to buffer them
+		if (fwUpdateOngoing && fwBlock && fwBufferCount < MY_OTA_BUFFERED_BLOCKS && (enter - fwLastRequestTime > MY_OTA_RETRY_DELAY)) {
 			if (!fwRetry) {
 				debug(PSTR("fw upd fail\n"));
 				// Give up. We have requested MY_OTA_RETRY times without any packet in return.
@@ -554,16 +888,52 @@ boolean MySensor::process() {
 		return false;
 	}
 
+#ifdef MY_NODE_STATS
+	unsigned long start = hw_micros();
+	boolean result = processPacket(to);
+	// Keep the sub-millisecond rest, most packets are handled in less than a millisecond
+	unsigned long us = processUs + (hw_micros() - start);
+	stats.processMs += us / 1000;
+	processUs = us % 1000;
+	return result;
+#else
+	return processPacket(to);
+#endif
+}
+
+boolean MySensor::processPacket(uint8_t to) {
 #ifdef MY_SIGNING_FEATURE
 	(void)signer.checkTimer(); // Manage signing timeout
 #endif
 
 	uint8_t len = radio.receive((uint8_t *)&msg);
-	(void)len; //until somebody makes use of 'len'
+	countStat(rx);
+#ifdef MY_E2E_ACK_FEATURE
+	// Message id after the payload, if the sender added one
+	msgId = (!mGetSigned(msg) && (mGetRequestAck(msg) || mGetAck(msg)) && len > HEADER_SIZE + mGetLength(msg)) ? msg.data[mGetLength(msg)] : 0;
+#endif
+#ifdef MY_TRACE
+	trace(TRACE_READ, to, msg);
+#endif
 #ifdef WITH_LEDS_BLINKING
 	rxBlink(1);
 #endif
 
+	if (repeaterMode && to == nc.nodeId && nc.nodeId != AUTO && nc.parentNodeId != AUTO && len >= HEADER_SIZE &&
+		msg.destination != nc.nodeId && msg.destination != BROADCAST_ADDRESS && mGetVersion(msg) == PROTOCOL_VERSION) {
+		// Just passing through, skip verification, parsing and debug printing
+#ifdef MY_NODE_TABLE
+		if (isGateway)
+			updateNodeTable();
+#endif
+		if (forward(len)) {
+			countStat(relayed);
+		} else {
+			countStat(dropped);
+		}
+		return false;
+	}
+
 #ifdef MY_SIGNING_FEATURE
 	// Before processing message, reject unsigned messages if signing is required and check signature (if it is signed and addressed to us)
 	// Note that we do not care at all about any signature found if we do not require signing, nor do we care about ACKs (they are never signed)
@@ -575,6 +945,8 @@ boolean MySensor::process() {
 		if (!mGetSigned(msg)) {
 			// Got unsigned message that should have been signed
 			debug(PSTR("no sign\n"));
+			countStat(signFail);
+			countStat(dropped);
 #ifdef WITH_LEDS_BLINKING
 			errBlink(1);
 #endif
@@ -582,6 +954,8 @@ boolean MySensor::process() {
 		}
 		else if (!signer.verifyMsg(msg)) {
 			debug(PSTR("verify fail\n"));
+			countStat(signFail);
+			countStat(dropped);
 #ifdef WITH_LEDS_BLINKING
 			errBlink(1);
 #endif
@@ -592,12 +966,15 @@ boolean MySensor::process() {
 
 	// Add string termination, good if we later would want to print it.
 	msg.data[mGetLength(msg)] = '\0';
+#ifndef MY_TRACE
 	debug(PSTR("read: %d-%d-%d s=%d,c=%d,t=%d,pt=%d,l=%d,sg=%d:%s\n"),
 				msg.sender, msg.last, msg.destination, msg.sensor, mGetCommand(msg), msg.type, mGetPayloadType(msg), mGetLength(msg), mGetSigned(msg), msg.getString(convBuf));
+#endif
 	mSetSigned(msg,0); // Clear the sign-flag now as verification (and debug printing) is completed
 
 	if(!(mGetVersion(msg) == PROTOCOL_VERSION)) {
 		debug(PSTR("ver mismatch\n"));
+		countStat(dropped);
 #ifdef WITH_LEDS_BLINKING
 		errBlink(1);
 #endif
@@ -610,6 +987,26 @@ boolean MySensor::process() {
 	uint8_t last = msg.last;
 	uint8_t destination = msg.destination;
 
+#ifdef MY_NODE_TABLE
+	if (isGateway)
+		updateNodeTable();
+#endif
+
+	if (command == C_INTERNAL && type == I_CHANNEL_CHANGE && sender == GATEWAY_ADDRESS && !isGateway) {
+		// Network moves to another channel. Repeaters pass broadcasts on before switching.
+		bool broadcast = destination == BROADCAST_ADDRESS;
+		if (broadcast && repeaterMode && nc.nodeId != AUTO)
+			sendWrite(BROADCAST_ADDRESS, msg);
+#ifdef MY_SIGNING_FEATURE
+		// Anyone could send an unsigned broadcast, wait for the signed one addressed to us
+		if (broadcast && signer.requestSignatures())
+			return false;
+#endif
+		if (broadcast || destination == nc.nodeId)
+			switchChannel(msg.getByte());
+		return false;
+	}
+
 	if (destination == nc.nodeId) {
 		// This message is addressed to this node
 
@@ -626,9 +1023,25 @@ boolean MySensor::process() {
 			mSetAck(tmpMsg,true);
 			tmpMsg.sender = nc.nodeId;
 			tmpMsg.destination = msg.sender;
+#ifdef MY_E2E_ACK_FEATURE
+			tmpMsg.data[mGetLength(tmpMsg)] = msgId;
+#endif
 			sendRoute(tmpMsg);
 		}
 
+#ifdef MY_E2E_ACK_FEATURE
+		if (msgId && mGetRequestAck(msg) && isDuplicate(sender, msgId)) {
+			// Retransmission of a message we already got (our ack got lost), acked again above
+			debug(PSTR("dup\n"));
+			return false;
+		}
+		if (e2eWait != NULL && mGetAck(msg) && sender == e2eWait->destination &&
+			(msgId ? msgId == e2eWaitId : msg.sensor == e2eWait->sensor && msg.type == e2eWait->type)) {
+			// The ack sendReliable() waits for (matched by sensor and type if the id got lost)
+			e2eAcked = true;
+		}
+#endif
+
 		if (command == C_INTERNAL) {
 			if (type == I_FIND_PARENT_RESPONSE) {
 				if (autoFindParent) {
@@ -641,6 +1054,9 @@ boolean MySensor::process() {
 						distance++;
 						if (isValidDistance(distance) && (distance < nc.distance)) {
 							// Found a neighbor closer to GW than previously found
+							if (msg.sender != nc.parentNodeId) {
+								countStat(parentChanges);
+							}
 							nc.distance = distance;
 							nc.parentNodeId = msg.sender;
 							hw_writeConfig(EEPROM_PARENT_NODE_ID_ADDRESS, nc.parentNodeId);
@@ -679,6 +1095,16 @@ boolean MySensor::process() {
 				return false; // Signing request is an internal MySensor protocol message, no need to inform caller about this
 			} else if (type == I_GET_NONCE_RESPONSE) {
 				return true; // Just pass along nonce silently (no need to call callback for these)
+#endif
+#ifdef MY_SLOTS
+			} else if (type == I_SLOT) {
+				if (isGateway) {
+					// Tell the node how long until its slot starts
+					sendRoute(MyTypedMessage<NODE_SENSOR_ID, I_SLOT, P_ULONG32, C_INTERNAL>::build(msg, nc.nodeId, sender, slotOffset(sender)));
+				} else if (sender == GATEWAY_ADDRESS) {
+					syncSlot(msg.getULong());
+				}
+				return false;
 #endif
 			} else if (sender == GATEWAY_ADDRESS) {
 				bool isMetric;
@@ -725,6 +1151,10 @@ boolean MySensor::process() {
 						// Deliver time to callback
 						timeCallback(msg.getULong());
 					}
+#ifdef MY_NODE_STATS
+				} else if (type == I_STATS) {
+					sendStats();
+#endif
 				}
 				return false;
 			}
@@ -736,52 +1166,47 @@ boolean MySensor::process() {
 				// compare with current node configuration, if they differ, start fw fetch process
 				if (memcmp(&fc,firmwareConfigResponse,sizeof(NodeFirmwareConfig))) {
 					debug(PSTR("fw update\n"));
-					// copy new FW config
-					memcpy(&fc,firmwareConfigResponse,sizeof(NodeFirmwareConfig));
+					fwUpdateOngoing = false;
 					// Init flash
 					if (!flash.initialize()) {
 						debug(PSTR("flash init fail\n"));
-						fwUpdateOngoing = false;
-					} else {
-						// erase lower 32K -> max flash size for ATMEGA328
-						flash.blockErase32K(0);
-						// wait until flash erased
-						while ( flash.busy() );
-						fwBlock = fc.blocks;
-						fwUpdateOngoing = true;
-						// reset flags
-						fwRetry = MY_OTA_RETRY+1;
-						fwLastRequestTime = 0;
+						return false;
+					}
+					// erase lower 32K -> max flash size for ATMEGA328
+					// Erase runs in the background, received blocks are buffered until it completes.
+					// Writes of an interrupted earlier update may still be pending, finish them first.
+					unsigned long enter = hw_millis();
+					while (!flash.submitErase32K(0)) {
+						if (hw_millis() - enter > FLASH_IDLE_TIMEOUT) {
+							// Keep the old config, so a repeated config response starts over
+							debug(PSTR("flash busy\n"));
+							return false;
+						}
+						flash.poll();
 					}
+					// copy new FW config
+					memcpy(&fc,firmwareConfigResponse,sizeof(NodeFirmwareConfig));
+					fwBlock = fc.blocks;
+					fwBufferHead = 0;
+					fwBufferCount = 0;
+					fwFlashing = false;
+					fwUpdateOngoing = true;
+					// reset flags
+					fwRetry = MY_OTA_RETRY+1;
+					fwLastRequestTime = 0;
 					return false;
 				} else debug(PSTR("fw update skipped\n"));
 			} else if (type == ST_FIRMWARE_RESPONSE) {
-				if (fwUpdateOngoing) {
-					// Save block to flash
+				if (fwUpdateOngoing && fwBlock && fwBufferCount < MY_OTA_BUFFERED_BLOCKS) {
+					// Buffer block, it is written to flash by processFirmwareFlash()
 					debug(PSTR("fw block %d\n"), fwBlock);
 					// extract FW block
 					ReplyFWBlock *firmwareResponse = (ReplyFWBlock *)msg.data;
-					// write to flash
-					flash.writeBytes( ((fwBlock - 1) * FIRMWARE_BLOCK_SIZE) + FIRMWARE_START_OFFSET, firmwareResponse->data, FIRMWARE_BLOCK_SIZE);
-					// wait until flash written
-					while ( flash.busy() );
+					uint8_t slot = (fwBufferHead + fwBufferCount) % MY_OTA_BUFFERED_BLOCKS;
+					memcpy(fwBuffer[slot], firmwareResponse->data, FIRMWARE_BLOCK_SIZE);
+					fwBufferBlock[slot] = fwBlock - 1;
+					fwBufferCount++;
 					fwBlock--;
-					if (!fwBlock) {
-						// We're finished! Do a checksum and reboot.
-						fwUpdateOngoing = false;
-						if (isValidFirmware()) {
-							debug(PSTR("fw checksum ok\n"));
-							// All seems ok, write size and signature to flash (DualOptiboot will pick this up and flash it)	
-							uint16_t fwsize = FIRMWARE_BLOCK_SIZE * fc.blocks;
-							uint8_t OTAbuffer[10] = {'F','L','X','I','M','G',':',(uint8_t)(fwsize >> 8),(uint8_t)(fwsize & 0xff),':'};
-							flash.writeBytes(0, OTAbuffer, 10);
-							// Write the new firmware config to eeprom
-							hw_writeConfigBlock((void*)&fc, (void*)EEPROM_FIRMWARE_TYPE_ADDRESS, sizeof(NodeFirmwareConfig));
-							hw_reboot();
-						} else {
-							debug(PSTR("fw checksum fail\n"));
-						}
-					}		
 					// reset flags
 					fwRetry = MY_OTA_RETRY+1;
 					fwLastRequestTime = 0;
@@ -812,12 +1237,20 @@ boolean MySensor::process() {
 					// Wait a random delay of 0-2 seconds to minimize collision
 					// between ping ack messages from other relaying nodes
 					wait(hw_millis() & 0x3ff);
-					sendWrite(sender, build(msg, nc.nodeId, sender, NODE_SENSOR_ID, C_INTERNAL, I_FIND_PARENT_RESPONSE, false).set(nc.distance));
+					sendWrite(sender, MyTypedMessage<NODE_SENSOR_ID, I_FIND_PARENT_RESPONSE, P_BYTE, C_INTERNAL>::build(msg, nc.nodeId, sender, nc.distance));
 				}
 			}
 		} else if (to == nc.nodeId) {
 			// We should try to relay this message to another node
-			sendRoute(msg);
+#ifdef MY_E2E_ACK_FEATURE
+			// Put the message id back, the string termination overwrote it
+			msg.data[mGetLength(msg)] = msgId;
+#endif
+			if (sendRoute(msg)) {
+				countStat(relayed);
+			} else {
+				countStat(dropped);
+			}
 		}
 	}
 	return false;
@@ -827,10 +1260,346 @@ MyMessage& MySensor::getLastMessage() {
 	return msg;
 }
 
+uint8_t MySensor::scanChannel(uint8_t channel, uint8_t samples) {
+	return radio.scanChannel(channel, samples);
+}
+
+void MySensor::changeChannel(uint8_t channel) {
+	MyMessage change;
+#ifdef MY_SIGNING_FEATURE
+	// Nodes requiring signatures ignore the broadcast. Tell them first, repeaters switch
+	// on the broadcast. Nodes behind repeaters go before the repeaters themselves.
+	for (uint8_t pass = 0; pass < 2; pass++) {
+		for (uint8_t node = 1; node < BROADCAST_ADDRESS; node++) {
+			uint8_t route = hw_readConfig(EEPROM_ROUTES_ADDRESS+node);
+			if (route == BROADCAST_ADDRESS || !DO_SIGN(node) || (route == node) != (pass == 1))
+				continue;
+			MyTypedMessage<NODE_SENSOR_ID, I_CHANNEL_CHANGE, P_BYTE, C_INTERNAL>::build(change, nc.nodeId, node, channel);
+			sendRoute(change);
+		}
+	}
+#endif
+	MyTypedMessage<NODE_SENSOR_ID, I_CHANNEL_CHANGE, P_BYTE, C_INTERNAL>::build(change, nc.nodeId, BROADCAST_ADDRESS, channel);
+	// Broadcasts are not acked, repeat a few times and give repeaters time to pass it on
+	for (uint8_t i = 0; i < 3; i++) {
+		sendWrite(BROADCAST_ADDRESS, change);
+		wait(200);
+	}
+	switchChannel(channel);
+}
+
+#ifdef MY_E2E_ACK_FEATURE
+void MySensor::reserveMsgIds() {
+	// Reserves the E2E_ID_BLOCK ids after nextMsgId, the last one is stored
+	uint16_t limit = nextMsgId + E2E_ID_BLOCK;
+	if (limit > E2E_ID_MAX)
+		limit -= E2E_ID_MAX;
+	msgIdLimit = limit;
+	hw_writeConfig(EEPROM_MSG_ID_ADDRESS, msgIdLimit);
+}
+
+uint8_t MySensor::newMsgId() {
+	nextMsgId = nextMsgId >= E2E_ID_MAX ? 1 : nextMsgId + 1;
+	if (nextMsgId == msgIdLimit)
+		reserveMsgIds();
+	return nextMsgId;
+}
+
+RttEstimate* MySensor::rttFor(uint8_t node) {
+	RttEstimate *free = NULL;
+	for (uint8_t i = 0; i < MY_E2E_DESTINATIONS; i++) {
+		if (rtt[i].node == node)
+			return &rtt[i];
+		if (rtt[i].node == AUTO)
+			free = &rtt[i];
+	}
+	if (free == NULL)
+		free = &rtt[node % MY_E2E_DESTINATIONS];
+	free->node = node;
+	free->srtt = 0;
+	return free;
+}
+
+bool MySensor::isDuplicate(uint8_t sender, uint8_t id) {
+	unsigned long now = hw_millis();
+	for (uint8_t i = 0; i < MY_E2E_DUPLICATES; i++) {
+		// Entries older than any retransmission are kept from matching a reused id
+		if (dupId[i] == id && dupSender[i] == sender && now - dupTime[i] < E2E_DUPLICATE_TIMEOUT)
+			return true;
+	}
+	dupSender[dupNext] = sender;
+	dupId[dupNext] = id;
+	dupTime[dupNext] = now;
+	if (++dupNext == MY_E2E_DUPLICATES)
+		dupNext = 0;
+	return false;
+}
+
+bool MySensor::sendReliable(MyMessage &message) {
+	// Work on a copy, message may be the receive buffer (gateway) which process() overwrites
+	MyMessage tx = message;
+	tx.sender = nc.nodeId;
+	mSetRequestAck(tx, true);
+	mSetAck(tx, false);
+	RttEstimate *est = rttFor(tx.destination);
+	unsigned long rto = est->srtt ? est->srtt + 4 * (unsigned long)est->rttvar : MY_E2E_INITIAL_RTO;
+	e2eWait = &tx;
+	e2eWaitId = newMsgId();
+	bool acked = false;
+	for (uint8_t attempt = 0; attempt <= MY_E2E_RETRIES && !acked; attempt++) {
+		if (rto < MY_E2E_MIN_RTO)
+			rto = MY_E2E_MIN_RTO;
+		else if (rto > MY_E2E_MAX_RTO)
+			rto = MY_E2E_MAX_RTO;
+		e2eAcked = false;
+		unsigned long sent = hw_millis();
+		// Retransmissions keep the id, so the destination can drop duplicates
+		txMsgId = e2eWaitId;
+		sendRoute(tx);
+		txMsgId = 0;
+		// Also waits before the retry if the first hop failed
+		while (!e2eAcked && hw_millis() - sent < rto)
+			process();
+		if (e2eAcked) {
+			acked = true;
+			if (attempt == 0) {
+				// Only first transmissions give unambiguous samples (Karn)
+				unsigned long sample = hw_millis() - sent;
+				if (!est->srtt) {
+					est->srtt = sample;
+					est->rttvar = sample / 2;
+				} else {
+					long err = (long)sample - est->srtt;
+					est->srtt += err / 8;
+					est->rttvar += ((err < 0 ? -err : err) - (long)est->rttvar) / 4;
+				}
+				if (!est->srtt)
+					est->srtt = 1; // 0 means no sample
+			}
+		}
+		rto *= 2;
+	}
+	e2eWait = NULL;
+	return acked;
+}
+#endif
+
+#ifdef MY_NODE_TABLE
+NodeInfo* MySensor::findNode(uint8_t nodeId) {
+	for (uint8_t i = 0; i < MY_NODE_TABLE_SIZE; i++) {
+		if (nodeTable[i].nodeId == nodeId)
+			return &nodeTable[i];
+	}
+	return NULL;
+}
+
+// Called by the gateway for every message received
+void MySensor::updateNodeTable() {
+	uint8_t sender = msg.sender;
+	if (sender == GATEWAY_ADDRESS || sender == AUTO)
+		return;
+	unsigned long now = hw_millis();
+	NodeInfo *node = findNode(sender);
+	if (node == NULL) {
+		// Take a free entry, or the one seen longest ago
+		node = &nodeTable[0];
+		for (uint8_t i = 0; i < MY_NODE_TABLE_SIZE && node->nodeId != AUTO; i++) {
+			if (nodeTable[i].nodeId == AUTO || now - nodeTable[i].lastSeen > now - node->lastSeen)
+				node = &nodeTable[i];
+		}
+		node->nodeId = sender;
+		node->parent = AUTO;
+		node->heartbeat = 0;
+		node->heartbeatSeen = 0;
+		node->heartbeatInterval = 0;
+	}
+	node->lastSeen = now;
+	node->alive = true;
+	if (msg.last == sender) {
+		// Heard directly
+		node->parent = GATEWAY_ADDRESS;
+	} else if (node->parent == GATEWAY_ADDRESS) {
+		// Moved behind a repeater, parent is unknown until the node reports it
+		node->parent = AUTO;
+	}
+	if (mGetCommand(msg) == C_INTERNAL) {
+		if (msg.type == I_CONFIG) {
+			// Sent by the node at start up with its parent as payload
+			node->parent = msg.getByte();
+		} else if (msg.type == I_HEARTBEAT) {
+			uint16_t heartbeat = msg.getUInt();
+			uint16_t secs = now / 1000;
+			if (!secs)
+				secs = 1; // 0 means no heartbeat yet
+			// Only consecutive heartbeats give the interval, the node may have rebooted in between
+			if (node->heartbeatSeen && heartbeat == (uint16_t)(node->heartbeat + 1))
+				node->heartbeatInterval = secs - node->heartbeatSeen;
+			node->heartbeat = heartbeat;
+			node->heartbeatSeen = secs;
+		}
+	}
+}
+
+// Checks one entry per call for timeout
+void MySensor::checkNodeTable() {
+	NodeInfo &node = nodeTable[nodeTableCheck];
+	if (++nodeTableCheck == MY_NODE_TABLE_SIZE)
+		nodeTableCheck = 0;
+	if (node.nodeId == AUTO)
+		return;
+	unsigned long silent = hw_millis() - node.lastSeen;
+	if (node.alive && silent > MY_NODE_TIMEOUT) {
+		node.alive = false;
+		debug(PSTR("node %d lost\n"), node.nodeId);
+	}
+	// Only nodes known to send heartbeats lose their route. Sleeping nodes that report on
+	// events keep it, commands (and preloaded acks) still reach them.
+	if (node.heartbeatInterval && silent / 1000 > (unsigned long)node.heartbeatInterval * MY_NODE_HEARTBEAT_MISSES &&
+		hw_readConfig(EEPROM_ROUTES_ADDRESS+node.nodeId) != 0xFF) {
+		// Stop routing to the node, the route is learned again when it reappears.
+		// Checked first, every removal is an EEPROM write.
+		node.alive = false;
+		hw_writeConfig(EEPROM_ROUTES_ADDRESS+node.nodeId, 0xFF);
+		debug(PSTR("node %d route expired\n"), node.nodeId);
+	}
+}
+
+const NodeInfo* MySensor::getNodeInfo(uint8_t index) {
+	if (index >= MY_NODE_TABLE_SIZE || nodeTable[index].nodeId == AUTO)
+		return NULL;
+	return &nodeTable[index];
+}
+
+uint8_t MySensor::getNodeDistance(uint8_t nodeId) {
+	// Limited, parents reported at different times may form a loop
+	for (uint8_t distance = 0; distance <= MY_NODE_TABLE_SIZE; distance++) {
+		if (nodeId == GATEWAY_ADDRESS)
+			return distance;
+		NodeInfo *node = findNode(nodeId);
+		if (node == NULL || node->parent == AUTO)
+			break;
+		nodeId = node->parent;
+	}
+	return DISTANCE_INVALID;
+}
+#endif
+
+#ifdef MY_TRACE
+void MySensor::trace(uint8_t event, uint8_t peer, MyMessage &message) {
+	uint8_t slot = traceHead + traceCount;
+	if (slot >= MY_TRACE_SIZE)
+		slot -= MY_TRACE_SIZE;
+	if (traceCount < MY_TRACE_SIZE) {
+		traceCount++;
+	} else if (++traceHead == MY_TRACE_SIZE) {
+		// Full, overwrite the oldest event
+		traceHead = 0;
+	}
+	MyTraceEvent &e = traceBuf[slot];
+	e.time = hw_micros();
+	e.event = event;
+	e.peer = peer;
+	memcpy(&e.last, &message, HEADER_SIZE);
+}
+
+void MySensor::traceDump() {
+	while (traceCount) {
+		MyTraceEvent e = traceBuf[traceHead];
+		if (++traceHead == MY_TRACE_SIZE)
+			traceHead = 0;
+		traceCount--;
+		if (e.event == TRACE_READ) {
+			debug(PSTR("%lu read: %d-%d-%d-%d s=%d,c=%d,t=%d,pt=%d,l=%d,sg=%d\n"),
+				(unsigned long)e.time, e.sender, e.last, e.peer, e.destination, e.sensor, mGetCommand(e), e.type,
+				mGetPayloadType(e), mGetLength(e), mGetSigned(e));
+		} else {
+			debug(PSTR("%lu send: %d-%d-%d-%d s=%d,c=%d,t=%d,pt=%d,l=%d,sg=%d,st=%s\n"),
+				(unsigned long)e.time, e.sender, e.last, e.peer, e.destination, e.sensor, mGetCommand(e), e.type,
+				mGetPayloadType(e), mGetLength(e), mGetSigned(e), e.event == TRACE_SEND_BC ? "bc" : (e.event == TRACE_SEND_OK ? "ok" : "fail"));
+		}
+	}
+}
+#endif
+
+void MySensor::switchChannel(uint8_t channel) {
+	if (radio.setChannel(channel)) {
+		hw_writeConfig(EEPROM_RADIO_CHANNEL_ADDRESS, channel);
+		channelStep = 0;
+		debug(PSTR("channel=%d\n"), channel);
+	}
+}
+
+#ifdef MY_EEPROM_JOURNAL
+void MySensor::loadJournal() {
+	// Start with the values checkpointed last time the journal wrapped
+	for (uint8_t pos = 0; pos < MY_EEPROM_JOURNAL_POSITIONS; pos++) {
+		stateShadow[pos] = hw_readConfig(EEPROM_LOCAL_CONFIG_ADDRESS+pos);
+	}
+	journalSlot = 0;
+	journalSeq = 0;
+	uint8_t seq = hw_readConfig(JOURNAL_RECORD_ADDRESS(0));
+	if (seq == JOURNAL_SEQ_INVALID) {
+		// Empty journal (or the first record of a wrap was interrupted). Pick a sequence
+		// number the old record in slot 1 can't continue.
+		seq = MY_EEPROM_JOURNAL_RECORDS > 1 ? hw_readConfig(JOURNAL_RECORD_ADDRESS(1)) : JOURNAL_SEQ_INVALID;
+		if (seq != JOURNAL_SEQ_INVALID)
+			journalSeq = journalNextSeq(journalNextSeq(seq));
+		return;
+	}
+	// Latest record is the last one of the unbroken sequence starting at slot 0
+	uint8_t latest = 0;
+	while (latest + 1 < MY_EEPROM_JOURNAL_RECORDS && hw_readConfig(JOURNAL_RECORD_ADDRESS(latest + 1)) == journalNextSeq(seq)) {
+		latest++;
+		seq = journalNextSeq(seq);
+	}
+	journalSlot = (latest + 1) % MY_EEPROM_JOURNAL_RECORDS;
+	journalSeq = journalNextSeq(seq);
+	// Replay records, oldest first
+	uint8_t slot = journalSlot;
+	do {
+		if (hw_readConfig(JOURNAL_RECORD_ADDRESS(slot)) != JOURNAL_SEQ_INVALID) {
+			uint8_t pos = hw_readConfig(JOURNAL_RECORD_ADDRESS(slot)+1);
+			if (pos < MY_EEPROM_JOURNAL_POSITIONS) {
+				stateShadow[pos] = hw_readConfig(JOURNAL_RECORD_ADDRESS(slot)+2);
+			}
+		}
+		slot = (slot + 1) % MY_EEPROM_JOURNAL_RECORDS;
+	} while (slot != journalSlot);
+}
+#endif
+
 void MySensor::saveState(uint8_t pos, uint8_t value) {
+#ifdef MY_EEPROM_JOURNAL
+	if (pos < MY_EEPROM_JOURNAL_POSITIONS) {
+		if (stateShadow[pos] == value) {
+			return;
+		}
+		stateShadow[pos] = value;
+		if (journalSlot == 0) {
+			// Journal wraps around. Checkpoint all values before the old records are overwritten.
+			for (uint8_t i = 0; i < MY_EEPROM_JOURNAL_POSITIONS; i++) {
+				hw_writeConfig(EEPROM_LOCAL_CONFIG_ADDRESS+i, stateShadow[i]);
+			}
+		}
+		// Invalidate the old record first, then write the new one. The sequence number
+		// is written last, it marks the record as valid.
+		hw_writeConfig(JOURNAL_RECORD_ADDRESS(journalSlot), JOURNAL_SEQ_INVALID);
+		hw_writeConfig(JOURNAL_RECORD_ADDRESS(journalSlot)+1, pos);
+		hw_writeConfig(JOURNAL_RECORD_ADDRESS(journalSlot)+2, value);
+		hw_writeConfig(JOURNAL_RECORD_ADDRESS(journalSlot), journalSeq);
+		journalSlot = (journalSlot + 1) % MY_EEPROM_JOURNAL_RECORDS;
+		journalSeq = journalNextSeq(journalSeq);
+		return;
+	}
+#endif
 	hw_writeConfig(EEPROM_LOCAL_CONFIG_ADDRESS+pos, value);
 }
 uint8_t MySensor::loadState(uint8_t pos) {
+#ifdef MY_EEPROM_JOURNAL
+	if (pos < MY_EEPROM_JOURNAL_POSITIONS) {
+		return stateShadow[pos];
+	}
+#endif
 	return hw_readConfig(EEPROM_LOCAL_CONFIG_ADDRESS+pos);
 }
 
@@ -839,6 +1608,19 @@ void MySensor::wait(unsigned long ms) {
 	while (hw_millis() - enter < ms) {
 		process();
 	}
+#ifdef MY_NODE_STATS
+	stats.waitMs += hw_millis() - enter;
+#endif
+}
+
+// Handles messages our parent attached to the ACK of our last transmission
+// before the radio is powered down
+void MySensor::processAckPayloads() {
+#ifdef MY_ACK_PAYLOAD_FEATURE
+	uint8_t to;
+	while (radio.available(&to))
+		process();
+#endif
 }
 
 void MySensor::sleep(unsigned long ms) {
@@ -848,6 +1630,7 @@ void MySensor::sleep(unsigned long ms) {
 		process();
 	} else {
 #endif
+		processAckPayloads();
 		radio.powerDown();
 		hw.sleep(ms);
 #ifdef MY_OTA_FIRMWARE_FEATURE
@@ -856,6 +1639,13 @@ void MySensor::sleep(unsigned long ms) {
 }
 
 bool MySensor::sleep(uint8_t interrupt, uint8_t mode, unsigned long ms) {
+#ifdef RF24_IRQ_NUM
+	if (interrupt == RF24_IRQ_NUM) {
+		// Taken by the radio, sleeping would detach its handler
+		debug(PSTR("sleep: irq %d busy\n"), RF24_IRQ_NUM);
+		return false;
+	}
+#endif
 #ifdef MY_OTA_FIRMWARE_FEATURE
 	if (fwUpdateOngoing) {
 		// Do not sleep node while fw update is ongoing
@@ -863,6 +1653,7 @@ bool MySensor::sleep(uint8_t interrupt, uint8_t mode, unsigned long ms) {
 		return false;
 	} else {
 #endif
+		processAckPayloads();
 		radio.powerDown();
 		return hw.sleep(interrupt, mode, ms) ;
 #ifdef MY_OTA_FIRMWARE_FEATURE
@@ -871,6 +1662,13 @@ bool MySensor::sleep(uint8_t interrupt, uint8_t mode, unsigned long ms) {
 }
 
 int8_t MySensor::sleep(uint8_t interrupt1, uint8_t mode1, uint8_t interrupt2, uint8_t mode2, unsigned long ms) {
+#ifdef RF24_IRQ_NUM
+	if (interrupt1 == RF24_IRQ_NUM || interrupt2 == RF24_IRQ_NUM) {
+		// Taken by the radio, sleeping would detach its handler
+		debug(PSTR("sleep: irq %d busy\n"), RF24_IRQ_NUM);
+		return -1;
+	}
+#endif
 #ifdef MY_OTA_FIRMWARE_FEATURE
 	if (fwUpdateOngoing) {
 		// Do not sleep node while fw update is ongoing
@@ -878,6 +1676,7 @@ int8_t MySensor::sleep(uint8_t interrupt1, uint8_t mode1, uint8_t interrupt2, ui
 		return -1;
 	} else {
 #endif
+		processAckPayloads();
 		radio.powerDown();
 		return hw.sleep(interrupt1, mode1, interrupt2, mode2, ms) ;
 #ifdef MY_OTA_FIRMWARE_FEATURE
@@ -885,3 +1684,55 @@ int8_t MySensor::sleep(uint8_t interrupt1, uint8_t mode1, uint8_t interrupt2, ui
 #endif
 }
 
+#ifdef MY_SLOTS
+void MySensor::syncSlot(unsigned long offset) {
+	if (slotSynced && slotSlept) {
+		// Compare with where we expected the slot to be to see how fast our sleep timer runs
+		unsigned long awake = hw_millis() - slotRef;
+		long expected = (long)slotDue - (long)(awake % MY_SLOT_PERIOD);
+		if (expected < 0)
+			expected += MY_SLOT_PERIOD;
+		// Positive when the slot is further away than expected, i.e. we slept too short
+		long error = (long)offset - expected;
+		if (error > (long)MY_SLOT_PERIOD / 2)
+			error -= MY_SLOT_PERIOD;
+		else if (error < -(long)MY_SLOT_PERIOD / 2)
+			error += MY_SLOT_PERIOD;
+		float rate = slotRate * ((long)slotSlept - error) / slotSlept;
+		if (rate > 0.5f && rate < 2.0f)
+			slotRate = rate;
+		debug(PSTR("slot err=%ld\n"), error);
+	}
+	slotRef = hw_millis();
+	slotDue = offset;
+	slotSlept = 0;
+	slotCycles = 0;
+	slotSynced = true;
+	slotReplied = true;
+}
+
+void MySensor::sleepUntilSlot() {
+	if (!slotSynced || slotCycles >= MY_SLOT_RESYNC) {
+		slotReplied = false;
+		sendRoute(build(msg, nc.nodeId, GATEWAY_ADDRESS, NODE_SENSOR_ID, C_INTERNAL, I_SLOT, false).set(""));
+		unsigned long enter = hw_millis();
+		while (!slotReplied && hw_millis() - enter < 2000)
+			process();
+		if (!slotSynced) {
+			sleep(MY_SLOT_PERIOD);
+			return;
+		}
+		// Without a reply keep going on the last sync, next cycle tries again
+	}
+	unsigned long awake = hw_millis() - slotRef;
+	long remaining = (long)slotDue - (long)(awake % MY_SLOT_PERIOD);
+	if (remaining <= 0)
+		remaining += MY_SLOT_PERIOD;
+	sleep((unsigned long)(remaining / slotRate));
+	// Whether hw_millis() runs during sleep depends on the platform, count from the wake up
+	slotRef = hw_millis();
+	slotDue = 0;
+	slotSlept += remaining;
+	slotCycles++;
+}
+#endif
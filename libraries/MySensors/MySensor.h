@@ -47,6 +47,9 @@ typedef MyHwESP8266 MyHwDriver;
 #elif defined(ARDUINO_ARCH_AVR)
 #include "MyHwATMega328.h"
 typedef MyHwATMega328 MyHwDriver;
+#elif defined(__linux__)
+#include "MyHwLinux.h"
+typedef MyHwLinux MyHwDriver;
 #endif
 //#endif
 
@@ -57,6 +60,16 @@ typedef MyHwATMega328 MyHwDriver;
 #define debug(x,...)
 #endif
 
+#if defined(MY_TRACE) && !defined(DEBUG)
+#error MY_TRACE requires DEBUG
+#endif
+
+#ifdef MY_NODE_STATS
+#define countStat(x) stats.x++
+#else
+#define countStat(x)
+#endif
+
 #ifdef WITH_LEDS_BLINKING_INVERSE
 #define LED_ON 0x1
 #define LED_OFF 0x0
@@ -82,9 +95,20 @@ typedef MyHwATMega328 MyHwDriver;
 #define EEPROM_FIRMWARE_CRC_ADDRESS (EEPROM_FIRMWARE_BLOCKS_ADDRESS+2)
 #define EEPROM_SIGNING_REQUIREMENT_TABLE_ADDRESS (EEPROM_FIRMWARE_CRC_ADDRESS+2)
 #define EEPROM_LOCAL_CONFIG_ADDRESS (EEPROM_SIGNING_REQUIREMENT_TABLE_ADDRESS+32) // First free address for sketch static configuration
+#define EEPROM_RADIO_CHANNEL_ADDRESS (EEPROM_LOCAL_CONFIG_ADDRESS+256) // Radio channel set by the gateway with changeChannel() (0xFF = use default)
+#define EEPROM_JOURNAL_ADDRESS (EEPROM_RADIO_CHANNEL_ADDRESS+1) // Where to store the saveState() journal (if MY_EEPROM_JOURNAL is enabled)
+#define EEPROM_MSG_ID_ADDRESS (EEPROM_JOURNAL_ADDRESS+MY_EEPROM_JOURNAL_RECORDS*3) // Last message id reserved by sendReliable() (if MY_E2E_ACK_FEATURE is enabled)
+
+// Trace events (MY_TRACE)
+#define TRACE_SEND_OK 0 // Unicast acked by next hop
+#define TRACE_SEND_FAIL 1 // Unicast not acked by next hop
+#define TRACE_SEND_BC 2 // Broadcast
+#define TRACE_READ 3 // Packet received (before signature/version checks)
 
 // Search for a new parent node after this many transmission failures
 #define SEARCH_FAILURES  5
+// Move on to the next channel candidate after this many parent searches without reply (see findParentNode())
+#define CHANNEL_FALLBACK_SEARCHES 3
 
 
 struct NodeConfig
@@ -98,6 +122,54 @@ struct ControllerConfig {
 	uint8_t isMetric;
 };
 
+// Node table entry (MY_NODE_TABLE)
+typedef struct {
+	uint8_t nodeId; // AUTO = free entry
+	uint8_t parent; // AUTO = unknown
+	uint8_t alive; // Heard from within MY_NODE_TIMEOUT
+	uint16_t heartbeat; // Last heartbeat counter received
+	uint16_t heartbeatSeen; // Seconds (hw_millis()/1000) when the last heartbeat arrived, 0 = none
+	uint16_t heartbeatInterval; // Seconds between two consecutive heartbeats, 0 = unknown
+	uint32_t lastSeen; // hw_millis() of the last message
+} __attribute__((packed)) NodeInfo;
+
+// Round trip time estimate for a destination (MY_E2E_ACK_FEATURE)
+typedef struct {
+	uint8_t node; // AUTO = free entry
+	uint16_t srtt; // Smoothed round trip time (ms), 0 = no sample yet
+	uint16_t rttvar; // Round trip time variation (ms)
+} RttEstimate;
+
+// Trace event (MY_TRACE). Header fields are a raw copy of the MyMessage header.
+typedef struct {
+	uint32_t time; // hw_micros()
+	uint8_t event; // TRACE_xxx
+	uint8_t peer; // Next hop when sending, address the packet was received on when reading
+	uint8_t last;
+	uint8_t sender;
+	uint8_t destination;
+	uint8_t version_length;
+	uint8_t command_ack_payload;
+	uint8_t type;
+	uint8_t sensor;
+} __attribute__((packed)) MyTraceEvent;
+
+// Runtime statistics (MY_NODE_STATS), sent as payload of I_STATS. Counters wrap around,
+// the controller should look at the difference between two reports.
+typedef struct {
+	uint16_t txOk; // Packets acked by the next hop (broadcasts not counted)
+	uint16_t txFail; // Packets not acked by the next hop
+	uint16_t rx; // Packets received
+	uint16_t relayed; // Packets forwarded for other nodes
+	uint16_t dropped; // Packets discarded (version mismatch, signing rejects, relaying failed)
+	uint8_t signFail; // Messages that could not be signed or verified
+	uint8_t parentChanges; // Number of times a new parent was picked
+	uint8_t failedTransmissionsPeak; // Highest number of consecutive failures to reach the parent
+	uint16_t freeRam; // Bytes free between heap and stack when the stats were sent
+	uint32_t processMs; // Time spent handling received packets in process()
+	uint32_t waitMs; // Time spent in wait()
+} __attribute__((packed)) NodeStats;
+
 
 // Size of each firmware block
 #define FIRMWARE_BLOCK_SIZE	16
@@ -107,6 +179,8 @@ struct ControllerConfig {
 #define MY_OTA_RETRY 5
 // Number of millisecons before re-request a fw block
 #define MY_OTA_RETRY_DELAY 500
+// Number of received fw blocks buffered in RAM while the external flash is busy erasing/programming
+#define MY_OTA_BUFFERED_BLOCKS 4
 // Start offset for firmware in flash (DualOptiboot wants to keeps a signature first)
 #define FIRMWARE_START_OFFSET 10
 // Bootloader version
@@ -216,6 +290,36 @@ class MySensor
 
 	boolean sendRoute(MyMessage &message);
 
+	/**
+	 * Sends several messages in a row, e.g. a scene the gateway fans out to many nodes.
+	 * Routed like sendRoute() but handed to the radio as one batch, so drivers that support it
+	 * (nRF24) stay in TX mode and pipeline frames for the same next hop. Messages that have to
+	 * be signed (or request an end-to-end ack) go through sendRoute() one by one.
+	 * Messages for different next hops may be sent in another order than given.
+	 *
+	 * @param messages Array of messages, sender and destination set
+	 * @param count Number of messages
+	 * @return Number of messages that reached their next hop
+	 */
+	uint8_t sendBatch(MyMessage *messages, uint8_t count);
+
+#ifdef MY_E2E_ACK_FEATURE
+	/**
+	 * Sends a message and waits for the ack of the destination itself (MY_E2E_ACK_FEATURE).
+	 * Retransmits up to MY_E2E_RETRIES times, with a timeout based on the measured round trip
+	 * time to the destination (doubled on every retry). Keeps process()ing meanwhile, the ack
+	 * is also passed to the callback as usual. The destination drops retransmitted duplicates.
+	 *
+	 * Blocks until acked or given up, up to the sum of all timeouts (about 15 s with the
+	 * defaults when the destination is unreachable). Don't use it where input must be read
+	 * meanwhile, e.g. for controller messages in a serial gateway (64 byte serial buffer).
+	 *
+	 * @param msg Message to send, the request ack flag is set
+	 * @return true if the destination acknowledged the message
+	 */
+	bool sendReliable(MyMessage &msg);
+#endif
+
 	/**
 	 * Send this nodes battery level to gateway.
 	 * @param level Level between 0-100(%)
@@ -230,6 +334,19 @@ class MySensor
 	 */
 	void sendHeartbeat(void);
 
+#ifdef MY_NODE_STATS
+	/**
+	 * Send the runtime statistics of this node to the gateway/controller (I_STATS, payload is NodeStats).
+	 * This is also the reply when the controller sends an I_STATS to the node.
+	 */
+	void sendStats(void);
+
+	/**
+	 * Returns the runtime statistics collected since start up
+	 */
+	NodeStats getStats();
+#endif
+
 	/**
 	* Requests a value from gateway or some other sensor in the radio network.
 	* Make sure to add callback-method in begin-method to handle request responses.
@@ -255,6 +372,12 @@ class MySensor
 	*/
 	boolean process();
 
+	/**
+	 * CRC16 (reflected polynomial 0xA001) used to validate firmware images.
+	 * Start with crc=0xFFFF and pass the result back in to continue over more data.
+	 */
+	static uint16_t crc16(uint16_t crc, const void* data, uint16_t len);
+
 	/**
 	 * Returns the most recent node configuration received from controller
 	 */
@@ -266,6 +389,7 @@ class MySensor
 	 *
 	 * You have 256 bytes to play with. Note that there is a limitation on the number
 	 * of writes the EEPROM can handle (~100 000 cycles on ATMega328).
+	 * Enable MY_EEPROM_JOURNAL in MyConfig.h if you save the same position often.
 	 *
 	 * @param pos The position to store value in (0-255)
 	 * @param Value to store in position
@@ -285,6 +409,54 @@ class MySensor
 	*/
 	MyMessage& getLastMessage(void);
 
+	/**
+	 * Listens on a radio channel for other traffic (used by the gateway for channel surveys).
+	 * The node can not receive anything on its own channel meanwhile.
+	 *
+	 * @param channel Channel to sample
+	 * @param samples Number of times to sample
+	 * @return Number of samples with traffic, 0xFF if not supported by the radio or channel out of range
+	 */
+	uint8_t scanChannel(uint8_t channel, uint8_t samples);
+
+#ifdef MY_NODE_TABLE
+	/**
+	 * Returns an entry of the node table of the gateway (MY_NODE_TABLE).
+	 *
+	 * @param index Entry 0 - MY_NODE_TABLE_SIZE-1
+	 * @return The entry, NULL if the entry is free
+	 */
+	const NodeInfo* getNodeInfo(uint8_t index);
+
+	/**
+	 * Number of hops between the gateway and a node, following the parents in the node table.
+	 * @return Distance, 0xFF if the path is not known
+	 */
+	uint8_t getNodeDistance(uint8_t nodeId);
+#endif
+
+#ifdef MY_TRACE
+	/**
+	 * Prints the recorded trace events (oldest first) as debug output and empties the trace.
+	 * Printing is slow, call this where timing does not matter.
+	 */
+	void traceDump();
+#endif
+
+	/**
+	 * Moves the whole network to another radio channel (gateway only).
+	 * The change is broadcasted (and passed on by repeaters) before the gateway itself switches.
+	 * Broadcasts can't be signed, so nodes requiring signatures ignore them. These get a signed
+	 * message addressed to them instead (nodes behind repeaters first).
+	 * All nodes store the new channel in EEPROM. Nodes that miss the change (e.g. sleeping) try
+	 * the default channel of their radio and then every channel in turn when they can't find a
+	 * parent on the stored channel.
+	 * Nodes running the MYSBootloader still request firmware on the default channel.
+	 *
+	 * @param channel The new channel
+	 */
+	void changeChannel(uint8_t channel);
+
 
 
 	/**
@@ -306,6 +478,7 @@ class MySensor
 	 * Sleep (PowerDownMode) the MCU and radio. Wake up on timer or pin change.
 	 * See: http://arduino.cc/en/Reference/attachInterrupt for details on modes and which pin
 	 * is assigned to what interrupt. On Nano/Pro Mini: 0=Pin2, 1=Pin3
+	 * Returns false at once if interrupt is RF24_IRQ_NUM (used by the radio).
 	 * @param interrupt Interrupt that should trigger the wakeup
 	 * @param mode RISING, FALLING, CHANGE
 	 * @param ms Number of milliseconds to sleep or 0 to sleep forever
@@ -317,6 +490,7 @@ class MySensor
 	 * Sleep (PowerDownMode) the MCU and radio. Wake up on timer or pin change for two separate interrupts.
 	 * See: http://arduino.cc/en/Reference/attachInterrupt for details on modes and which pin
 	 * is assigned to what interrupt. On Nano/Pro Mini: 0=Pin2, 1=Pin3
+	 * Returns -1 at once if one of the interrupts is RF24_IRQ_NUM (used by the radio).
 	 * @param interrupt1 First interrupt that should trigger the wakeup
 	 * @param mode1 Mode for first interrupt (RISING, FALLING, CHANGE)
 	 * @param interrupt2 Second interrupt that should trigger the wakeup
@@ -326,6 +500,17 @@ class MySensor
 	 */
 	int8_t sleep(uint8_t interrupt1, uint8_t mode1, uint8_t interrupt2, uint8_t mode2, unsigned long ms=0);
 
+#ifdef MY_SLOTS
+	/**
+	 * Sleep until the start of this node's reporting slot (MY_SLOTS). Call it instead of sleep()
+	 * at the end of loop(), every node then sends in its own slot of the MY_SLOT_PERIOD cycle.
+	 * The slot position is fetched from the gateway on the first call and every MY_SLOT_RESYNC
+	 * cycles, which also corrects the drift of the sleep timer. Sleeps a whole period if the
+	 * gateway doesn't answer.
+	 */
+	void sleepUntilSlot();
+#endif
+
 #ifdef WITH_LEDS_BLINKING
 	/**
 	 * Blink with LEDs
@@ -374,6 +559,11 @@ class MySensor
 	unsigned long fwLastRequestTime;
 	uint16_t fwBlock;
 	uint8_t fwRetry;
+	uint8_t fwBuffer[MY_OTA_BUFFERED_BLOCKS][FIRMWARE_BLOCK_SIZE]; // Received blocks waiting to be written to flash
+	uint16_t fwBufferBlock[MY_OTA_BUFFERED_BLOCKS];
+	uint8_t fwBufferHead;
+	uint8_t fwBufferCount;
+	bool fwFlashing; // Block at fwBufferHead has been submitted to flash
 	SPIFlash flash;
 #endif
 	MyHw& hw;
@@ -385,19 +575,81 @@ class MySensor
 	char convBuf[MAX_PAYLOAD*2+1];
 #endif
 	uint8_t failedTransmissions;
+	uint8_t failedSearches; // Parent searches without reply (see CHANNEL_FALLBACK_SEARCHES)
+	uint8_t channelStep; // Channel candidate tried by findParentNode(), 0 = stored channel
 	uint16_t heartbeat;
+#ifdef MY_TRACE
+	MyTraceEvent traceBuf[MY_TRACE_SIZE];
+	uint8_t traceHead; // Oldest event
+	uint8_t traceCount;
+	void trace(uint8_t event, uint8_t peer, MyMessage &message);
+#endif
+#ifdef MY_E2E_ACK_FEATURE
+	uint8_t msgId; // Message id of msg, 0 = none
+	uint8_t nextMsgId; // Last id used
+	uint8_t msgIdLimit; // Last reserved id, using it reserves the next block of ids in EEPROM
+	uint8_t txMsgId; // Id for the message sent by sendReliable(), 0 = none
+	MyMessage *e2eWait; // Message sendReliable() waits the ack for
+	uint8_t e2eWaitId;
+	bool e2eAcked;
+	RttEstimate rtt[MY_E2E_DESTINATIONS];
+	uint8_t dupSender[MY_E2E_DUPLICATES];
+	uint8_t dupId[MY_E2E_DUPLICATES];
+	unsigned long dupTime[MY_E2E_DUPLICATES];
+	uint8_t dupNext;
+	void reserveMsgIds();
+	uint8_t newMsgId();
+	RttEstimate* rttFor(uint8_t node);
+	bool isDuplicate(uint8_t sender, uint8_t id);
+#endif
+#ifdef MY_NODE_TABLE
+	NodeInfo nodeTable[MY_NODE_TABLE_SIZE];
+	uint8_t nodeTableCheck; // Next entry to check for timeout
+	NodeInfo* findNode(uint8_t nodeId);
+	void updateNodeTable();
+	void checkNodeTable();
+#endif
+#ifdef MY_SLOTS
+	unsigned long slotRef; // hw_millis() when slotDue was set
+	unsigned long slotDue; // Real time after slotRef until our slot starts
+	unsigned long slotSlept; // Real time the node meant to sleep since the last sync
+	float slotRate; // Real time per ms of hw.sleep(), measured at each sync
+	uint8_t slotCycles; // Cycles since the last sync
+	bool slotSynced;
+	bool slotReplied;
+	void syncSlot(unsigned long offset);
+#endif
+#ifdef MY_NODE_STATS
+	NodeStats stats;
+	uint16_t processUs; // Part of the process() time not yet added to stats.processMs
+#endif
     void (*timeCallback)(unsigned long); // Callback for requested time messages
     void (*msgCallback)(const MyMessage &); // Callback for incoming messages from other nodes and gateway.
+#ifdef MY_EEPROM_JOURNAL
+	uint8_t stateShadow[MY_EEPROM_JOURNAL_POSITIONS]; // Current values of journaled positions
+	uint8_t journalSlot; // Next journal record to write
+	uint8_t journalSeq; // Sequence number of next journal record
+	void loadJournal();
+#endif
 
 #ifdef MY_OTA_FIRMWARE_FEATURE
 // do a crc16 on the whole received firmware
     bool isValidFirmware();
+// move buffered fw blocks to flash without blocking, finish update when all blocks are written
+    void processFirmwareFlash();
 #endif
 
 
+    boolean processPacket(uint8_t to);
+	boolean forward(uint8_t len);
+	void trackParentFailures(bool ok);
+	void logSend(uint8_t to, MyMessage &message, bool ok);
     void requestNodeId();
 	void setupNode();
 	void findParentNode();
+	void processAckPayloads();
+	void switchChannel(uint8_t channel);
+	uint8_t fallbackChannel(uint8_t step);
 	uint8_t crc8Message(MyMessage &message);
 };
 #endif
@@ -87,16 +87,16 @@ bool MySigningAtsha204::getNonce(MyMessage &msg) {
 		}
 		current_nonce[i] = rx_buffer[SHA204_BUFFER_POS_DATA];
 	}
-	memcpy(current_nonce, sha256(current_nonce, 32), MAX_PAYLOAD);
+	memcpy(current_nonce, sha256(current_nonce, 32), SIGNED_PAYLOAD);
 
 	// We set the part of the 32-byte nonce that does not fit into a message to 0xAA
-	memset(&current_nonce[MAX_PAYLOAD], 0xAA, sizeof(current_nonce)-MAX_PAYLOAD);
+	memset(&current_nonce[SIGNED_PAYLOAD], 0xAA, sizeof(current_nonce)-SIGNED_PAYLOAD);
 
 	// Replace the first byte in the nonce with our signing identifier
 	current_nonce[0] = SIGNING_IDENTIFIER;
 
 	// Transfer the first part of the nonce to the message
-	msg.set(current_nonce, MAX_PAYLOAD);
+	msg.set(current_nonce, SIGNED_PAYLOAD);
 	verification_ongoing = true;
 	timestamp = millis(); // Set timestamp to determine when to purge nonce
 	// Be a little fancy to handle turnover (prolong the time allowed to timeout after turnover)
@@ -125,15 +125,15 @@ bool MySigningAtsha204::putNonce(MyMessage &msg) {
 		return false; 
 	}
 
-	memcpy(current_nonce, (uint8_t*)msg.getCustom(), MAX_PAYLOAD);
+	memcpy(current_nonce, (uint8_t*)msg.getCustom(), SIGNED_PAYLOAD);
 	// We set the part of the 32-byte nonce that does not fit into a message to 0xAA
-	memset(&current_nonce[MAX_PAYLOAD], 0xAA, sizeof(current_nonce)-MAX_PAYLOAD);
+	memset(&current_nonce[SIGNED_PAYLOAD], 0xAA, sizeof(current_nonce)-SIGNED_PAYLOAD);
 	return true;
 }
 
 bool MySigningAtsha204::signMsg(MyMessage &msg) {
 	// If we cannot fit any signature in the message, refuse to sign it
-	if (mGetLength(msg) > MAX_PAYLOAD-2) {
+	if (mGetLength(msg) > SIGNED_PAYLOAD-2) {
 		DEBUG_SIGNING_PRINTLN(F("MTOL")); // Message too large for signature to fit
 		return false; 
 	}
@@ -155,7 +155,7 @@ bool MySigningAtsha204::signMsg(MyMessage &msg) {
 	rx_buffer[SHA204_BUFFER_POS_DATA] = SIGNING_IDENTIFIER;
 
 	// Transfer as much signature data as the remaining space in the message permits
-	memcpy(&msg.data[mGetLength(msg)], &rx_buffer[SHA204_BUFFER_POS_DATA], MAX_PAYLOAD-mGetLength(msg));
+	memcpy(&msg.data[mGetLength(msg)], &rx_buffer[SHA204_BUFFER_POS_DATA], SIGNED_PAYLOAD-mGetLength(msg));
 
 	return true;
 }
@@ -177,7 +177,7 @@ bool MySigningAtsha204::verifyMsg(MyMessage &msg) {
 			return false; 
 		}
 
-		DEBUG_SIGNING_PRINTBUF(F("SIM:"), (uint8_t*)&msg.data[mGetLength(msg)], MAX_PAYLOAD-mGetLength(msg)); // SIM = Signature in message
+		DEBUG_SIGNING_PRINTBUF(F("SIM:"), (uint8_t*)&msg.data[mGetLength(msg)], SIGNED_PAYLOAD-mGetLength(msg)); // SIM = Signature in message
 		calculateSignature(msg); // Get signature of message
 
 #ifdef MY_SECURE_NODE_WHITELISTING
@@ -198,8 +198,8 @@ bool MySigningAtsha204::verifyMsg(MyMessage &msg) {
 		rx_buffer[SHA204_BUFFER_POS_DATA] = SIGNING_IDENTIFIER;
 
 		// Compare the caluclated signature with the provided signature
-		if (memcmp(&msg.data[mGetLength(msg)], &rx_buffer[SHA204_BUFFER_POS_DATA], MAX_PAYLOAD-mGetLength(msg))) {
-			DEBUG_SIGNING_PRINTBUF(F("SNOK:"), &rx_buffer[SHA204_BUFFER_POS_DATA], MAX_PAYLOAD-mGetLength(msg)); // SNOK = Signature bad
+		if (memcmp(&msg.data[mGetLength(msg)], &rx_buffer[SHA204_BUFFER_POS_DATA], SIGNED_PAYLOAD-mGetLength(msg))) {
+			DEBUG_SIGNING_PRINTBUF(F("SNOK:"), &rx_buffer[SHA204_BUFFER_POS_DATA], SIGNED_PAYLOAD-mGetLength(msg)); // SNOK = Signature bad
 #ifdef MY_SECURE_NODE_WHITELISTING
 			DEBUG_SIGNING_PRINTLN(F("W?")); // W? = Is the sender whitelisted?
 #endif
@@ -214,10 +214,11 @@ bool MySigningAtsha204::verifyMsg(MyMessage &msg) {
 // Helper to calculate signature of msg (returned in rx_buffer[SHA204_BUFFER_POS_DATA])
 void MySigningAtsha204::calculateSignature(MyMessage &msg) {
 	memset(temp_message, 0, 32);
-	memcpy(temp_message, (uint8_t*)&msg.data[1-HEADER_SIZE], MAX_MESSAGE_LENGTH-1-(MAX_PAYLOAD-mGetLength(msg)));
+	// Signed from sender onwards, last is rewritten on every hop
+	memcpy(temp_message, (uint8_t*)&msg + 1, SIGNED_MESSAGE_LENGTH-1-(SIGNED_PAYLOAD-mGetLength(msg)));
 
 	// Program the data to sign into the ATSHA204
-	DEBUG_SIGNING_PRINTBUF(F("MSG:"), (uint8_t*)&msg.data[1-HEADER_SIZE], MAX_MESSAGE_LENGTH-1-(MAX_PAYLOAD-mGetLength(msg))); // MSG = Message to sign
+	DEBUG_SIGNING_PRINTBUF(F("MSG:"), (uint8_t*)&msg + 1, SIGNED_MESSAGE_LENGTH-1-(SIGNED_PAYLOAD-mGetLength(msg))); // MSG = Message to sign
 	DEBUG_SIGNING_PRINTBUF(F("CNC:"), current_nonce, 32); // CNC = Current nonce
 	(void)atsha204.sha204m_execute(SHA204_WRITE, SHA204_ZONE_DATA | SHA204_ZONE_COUNT_FLAG, 8 << 3, 32, temp_message,
 									WRITE_COUNT_LONG, tx_buffer, WRITE_RSP_SIZE, rx_buffer);
@@ -95,16 +95,16 @@ bool MySigningAtsha204Soft::getNonce(MyMessage &msg) {
 	for (int i = 0; i < 32; i++) {
 		Sha256.write(random(255));
 	}
-	memcpy(current_nonce, Sha256.result(), MAX_PAYLOAD);
+	memcpy(current_nonce, Sha256.result(), SIGNED_PAYLOAD);
 
 	// We set the part of the 32-byte nonce that does not fit into a message to 0xAA
-	memset(&current_nonce[MAX_PAYLOAD], 0xAA, sizeof(current_nonce)-MAX_PAYLOAD);
+	memset(&current_nonce[SIGNED_PAYLOAD], 0xAA, sizeof(current_nonce)-SIGNED_PAYLOAD);
 
 	// Replace the first byte in the nonce with our signing identifier
 	current_nonce[0] = SIGNING_IDENTIFIER;
 	
 	// Transfer the first part of the nonce to the message
-	msg.set(current_nonce, MAX_PAYLOAD);
+	msg.set(current_nonce, SIGNED_PAYLOAD);
 	verification_ongoing = true;
 	timestamp = millis(); // Set timestamp to determine when to purge nonce
 	// Be a little fancy to handle turnover (prolong the time allowed to timeout after turnover)
@@ -133,13 +133,13 @@ bool MySigningAtsha204Soft::putNonce(MyMessage &msg) {
 		return false; 
 	}
 
-	memcpy(current_nonce, (uint8_t*)msg.getCustom(), MAX_PAYLOAD);
+	memcpy(current_nonce, (uint8_t*)msg.getCustom(), SIGNED_PAYLOAD);
 	return true;
 }
 
 bool MySigningAtsha204Soft::signMsg(MyMessage &msg) {
 	// If we cannot fit any signature in the message, refuse to sign it
-	if (mGetLength(msg) > MAX_PAYLOAD-2) {
+	if (mGetLength(msg) > SIGNED_PAYLOAD-2) {
 		DEBUG_SIGNING_PRINTLN(F("MTOL")); // Message too large for signature to fit
 		return false; 
 	}
@@ -162,7 +162,7 @@ bool MySigningAtsha204Soft::signMsg(MyMessage &msg) {
 	hmac[0] = SIGNING_IDENTIFIER;
 
 	// Transfer as much signature data as the remaining space in the message permits
-	memcpy(&msg.data[mGetLength(msg)], hmac, MAX_PAYLOAD-mGetLength(msg));
+	memcpy(&msg.data[mGetLength(msg)], hmac, SIGNED_PAYLOAD-mGetLength(msg));
 
 	return true;
 }
@@ -185,7 +185,7 @@ bool MySigningAtsha204Soft::verifyMsg(MyMessage &msg) {
 		}
 
 		// Get signature of message
-		DEBUG_SIGNING_PRINTBUF(F("SIM:"), (uint8_t*)&msg.data[mGetLength(msg)], MAX_PAYLOAD-mGetLength(msg)); // SIM = Signature in message
+		DEBUG_SIGNING_PRINTBUF(F("SIM:"), (uint8_t*)&msg.data[mGetLength(msg)], SIGNED_PAYLOAD-mGetLength(msg)); // SIM = Signature in message
 		calculateSignature(msg);
 
 #ifdef MY_SECURE_NODE_WHITELISTING
@@ -207,8 +207,8 @@ bool MySigningAtsha204Soft::verifyMsg(MyMessage &msg) {
 		hmac[0] = SIGNING_IDENTIFIER;
 
 		// Compare the caluclated signature with the provided signature
-		if (memcmp(&msg.data[mGetLength(msg)], hmac, MAX_PAYLOAD-mGetLength(msg))) {
-			DEBUG_SIGNING_PRINTBUF(F("SNOK:"), hmac, MAX_PAYLOAD-mGetLength(msg)); // SNOK = Signature bad
+		if (memcmp(&msg.data[mGetLength(msg)], hmac, SIGNED_PAYLOAD-mGetLength(msg))) {
+			DEBUG_SIGNING_PRINTBUF(F("SNOK:"), hmac, SIGNED_PAYLOAD-mGetLength(msg)); // SNOK = Signature bad
 #ifdef MY_SECURE_NODE_WHITELISTING
 			DEBUG_SIGNING_PRINTLN(F("W?")); // W? = Is the sender whitelisted?
 #endif
@@ -223,8 +223,9 @@ bool MySigningAtsha204Soft::verifyMsg(MyMessage &msg) {
 // Helper to calculate signature of msg (returned in hmac)
 void MySigningAtsha204Soft::calculateSignature(MyMessage &msg) {
 	memset(temp_message, 0, 32);
-	memcpy(temp_message, (uint8_t*)&msg.data[1-HEADER_SIZE], MAX_MESSAGE_LENGTH-1-(MAX_PAYLOAD-mGetLength(msg)));
-	DEBUG_SIGNING_PRINTBUF(F("MSG:"), (uint8_t*)&msg.data[1-HEADER_SIZE], MAX_MESSAGE_LENGTH-1-(MAX_PAYLOAD-mGetLength(msg))); // MSG = Message to sign
+	// Signed from sender onwards, last is rewritten on every hop
+	memcpy(temp_message, (uint8_t*)&msg + 1, SIGNED_MESSAGE_LENGTH-1-(SIGNED_PAYLOAD-mGetLength(msg)));
+	DEBUG_SIGNING_PRINTBUF(F("MSG:"), (uint8_t*)&msg + 1, SIGNED_MESSAGE_LENGTH-1-(SIGNED_PAYLOAD-mGetLength(msg))); // MSG = Message to sign
 	DEBUG_SIGNING_PRINTBUF(F("CNC:"), current_nonce, 32); // CNC = Current nonce
 
 	// ATSHA204 calculates the HMAC with a PSK and a SHA256 digest of the following data:
@@ -78,7 +78,7 @@ bool MySigningNone::putNonce(MyMessage &msg) {
 
 bool MySigningNone::signMsg(MyMessage &msg) {
 	// If we cannot fit any signature in the message, refuse to sign it
-	if (mGetLength(msg) > MAX_PAYLOAD-2) {
+	if (mGetLength(msg) > SIGNED_PAYLOAD-2) {
 		DEBUG_SIGNING_PRINTLN(F("MTOL")); // Message too large for signature to fit
 		return false; 
 	}
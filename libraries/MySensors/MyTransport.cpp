@@ -20,4 +20,46 @@
 #include "MyTransport.h"
 
 MyTransport::MyTransport() {
+	_txStatus = MY_TX_IDLE;
+}
+
+uint8_t MyTransport::sendBatch(MyTransportFrame *frames, uint8_t count) {
+	uint8_t sent = 0;
+	for (uint8_t i = 0; i < count; i++) {
+		frames[i].ok = send(frames[i].to, frames[i].data, frames[i].len);
+		if (frames[i].ok)
+			sent++;
+	}
+	return sent;
+}
+
+uint8_t MyTransport::getMTU() {
+	return MY_TRANSPORT_DEFAULT_MTU;
+}
+
+bool MyTransport::preloadAck(uint8_t to, const void* data, uint8_t len) {
+	(void)to;
+	(void)data;
+	(void)len;
+	return false;
+}
+
+bool MyTransport::setChannel(uint8_t channel) {
+	(void)channel;
+	return false;
+}
+
+uint8_t MyTransport::scanChannel(uint8_t channel, uint8_t samples) {
+	(void)channel;
+	(void)samples;
+	return 0xFF;
+}
+
+bool MyTransport::startSend(uint8_t to, const void* data, uint8_t len) {
+	_txStatus = send(to, data, len) ? MY_TX_OK : MY_TX_FAILED;
+	return true;
+}
+
+uint8_t MyTransport::sendStatus() {
+	return _txStatus;
 }
@@ -29,6 +29,26 @@
 #define GATEWAY_ADDRESS ((uint8_t)0)
 #define BROADCAST_ADDRESS ((uint8_t)0xFF)
 
+// sendStatus() results
+#define MY_TX_IDLE ((uint8_t)0) // Nothing sent yet
+#define MY_TX_BUSY ((uint8_t)1) // Transmission in progress
+#define MY_TX_OK ((uint8_t)2) // Packet delivered
+#define MY_TX_FAILED ((uint8_t)3) // Packet not delivered
+
+// setChannel() argument for the channel the driver was configured with
+#define CHANNEL_DEFAULT ((uint8_t)0xFF)
+
+// Frame size of the nRF24, the MTU of drivers that do not tell otherwise
+#define MY_TRANSPORT_DEFAULT_MTU ((uint8_t)32)
+
+// One packet of a sendBatch() call
+struct MyTransportFrame {
+	uint8_t to;
+	const void* data;
+	uint8_t len;
+	bool ok; // Set by sendBatch()
+};
+
 class MyTransport
 {
 public:
@@ -50,6 +70,36 @@ public:
 	// reliable transmission of the data with given length (in bytes) to the destination address
 	// returns true if successfully submitted
 	virtual bool send(uint8_t to, const void* data, uint8_t len) = 0;
+	// sendBatch(frames, count)
+	// sends several packets in a row. Drivers that can keep the radio in TX mode between packets
+	// override this, the default just calls send() for each frame. Keep frames to the same
+	// destination next to each other.
+	// sets "ok" of every frame and returns the number of frames successfully submitted
+	virtual uint8_t sendBatch(MyTransportFrame *frames, uint8_t count);
+	// getMTU()
+	// returns the largest packet (in bytes) the driver can send in one frame
+	virtual uint8_t getMTU();
+	// startSend(to, data, len)
+	// starts transmission of a packet and returns without waiting for the result (data is copied).
+	// Drivers without background transmission complete the send before returning.
+	// returns false if the previous packet is still in progress
+	virtual bool startSend(uint8_t to, const void* data, uint8_t len);
+	// sendStatus()
+	// moves a transmission started with startSend() forward and returns its state (MY_TX_*)
+	virtual uint8_t sendStatus();
+	// preloadAck(to, data, len)
+	// hands a packet for node "to" over with the ACK of the next packet received from that node
+	// (e.g. a command for a sleeping node). Only one packet can be pending, it replaces any earlier one.
+	// returns false if not supported by the driver or the packet is too long
+	virtual bool preloadAck(uint8_t to, const void* data, uint8_t len);
+	// setChannel(channel)
+	// moves the radio to another channel, CHANNEL_DEFAULT moves it back to the channel it was configured with
+	// returns false if not supported by the driver or channel is out of range
+	virtual bool setChannel(uint8_t channel);
+	// scanChannel(channel, samples)
+	// listens "samples" times on channel (leaving the current channel for a moment)
+	// returns the number of samples where other traffic was detected, 0xFF if not supported or channel is out of range
+	virtual uint8_t scanChannel(uint8_t channel, uint8_t samples);
 	// available(to)
 	// returns true if a new packet arrived in the rx buffer
 	// populates "to" parameter with the address the packet was sent to (either own address or broadcast)
@@ -60,6 +110,8 @@ public:
 	virtual uint8_t receive(void* data) = 0;
 	// powers down the radio
 	virtual void powerDown() = 0;
+protected:
+	uint8_t _txStatus; // Result of last startSend() for drivers without background transmission
 };
 
 #endif
@@ -0,0 +1,138 @@
+/**
+ * The MySensors Arduino library handles the wireless radio link and protocol
+ * between your home built sensors/actuators and HA controller of choice.
+ * The sensors forms a self healing radio network with optional repeaters. Each
+ * repeater and gateway builds a routing tables in EEPROM which keeps track of the
+ * network topology allowing messages to be routed to nodes.
+ *
+ * Created by Henrik Ekblad <henrik.ekblad@mysensors.org>
+ * Copyright (C) 2013-2015 Sensnology AB
+ * Full contributor list: https://github.com/mysensors/Arduino/graphs/contributors
+ *
+ * Documentation: http://www.mysensors.org
+ * Support Forum: http://forum.mysensors.org
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * version 2 as published by the Free Software Foundation.
+ */
+
+#include "MyTransportDual.h"
+#include <string.h>
+
+#define MEDIUM_UNKNOWN 0xFF
+
+MyTransportDual::MyTransportDual(MyTransport &primary, MyTransport &secondary)
+	:
+	MyTransport(),
+	_rx(0)
+{
+	_radio[0] = &primary;
+	_radio[1] = &secondary;
+	memset(_known, 0, sizeof(_known));
+	memset(_secondary, 0, sizeof(_secondary));
+}
+
+bool MyTransportDual::init() {
+	bool ok = _radio[0]->init();
+	return _radio[1]->init() && ok;
+}
+
+void MyTransportDual::setAddress(uint8_t address) {
+	_radio[0]->setAddress(address);
+	_radio[1]->setAddress(address);
+}
+
+uint8_t MyTransportDual::getAddress() {
+	return _radio[0]->getAddress();
+}
+
+uint8_t MyTransportDual::mediumOf(uint8_t node) {
+	uint8_t mask = 1 << (node & 7);
+	if (!(_known[node >> 3] & mask))
+		return MEDIUM_UNKNOWN;
+	return (_secondary[node >> 3] & mask) ? 1 : 0;
+}
+
+void MyTransportDual::learn(uint8_t node, uint8_t medium) {
+	uint8_t mask = 1 << (node & 7);
+	_known[node >> 3] |= mask;
+	if (medium)
+		_secondary[node >> 3] |= mask;
+	else
+		_secondary[node >> 3] &= ~mask;
+}
+
+bool MyTransportDual::send(uint8_t to, const void* data, uint8_t len) {
+	if (to == BROADCAST_ADDRESS) {
+		bool ok = _radio[0]->send(to, data, len);
+		return _radio[1]->send(to, data, len) || ok;
+	}
+	uint8_t medium = mediumOf(to);
+	if (medium != MEDIUM_UNKNOWN) {
+		if (_radio[medium]->send(to, data, len))
+			return true;
+		// The node may have moved to the other medium
+		medium ^= 1;
+		if (_radio[medium]->send(to, data, len)) {
+			learn(to, medium);
+			return true;
+		}
+		return false;
+	}
+	// Not heard from this node yet (e.g. after a restart), find it
+	for (medium = 0; medium < 2; medium++) {
+		if (_radio[medium]->send(to, data, len)) {
+			learn(to, medium);
+			return true;
+		}
+	}
+	return false;
+}
+
+uint8_t MyTransportDual::getMTU() {
+	uint8_t mtu = _radio[0]->getMTU();
+	uint8_t mtu2 = _radio[1]->getMTU();
+	return mtu2 < mtu ? mtu2 : mtu;
+}
+
+bool MyTransportDual::preloadAck(uint8_t to, const void* data, uint8_t len) {
+	uint8_t medium = mediumOf(to);
+	if (medium == MEDIUM_UNKNOWN)
+		return false;
+	return _radio[medium]->preloadAck(to, data, len);
+}
+
+bool MyTransportDual::setChannel(uint8_t channel) {
+	return _radio[0]->setChannel(channel);
+}
+
+uint8_t MyTransportDual::scanChannel(uint8_t channel, uint8_t samples) {
+	return _radio[0]->scanChannel(channel, samples);
+}
+
+bool MyTransportDual::available(uint8_t *to) {
+	// Poll the radio that was not served last time first, so a busy medium can't starve the other
+	for (uint8_t i = 0; i < 2; i++) {
+		uint8_t r = _rx ^ 1;
+		if (_radio[r]->available(to)) {
+			_rx = r;
+			return true;
+		}
+		_rx = r;
+	}
+	return false;
+}
+
+uint8_t MyTransportDual::receive(void* data) {
+	uint8_t len = _radio[_rx]->receive(data);
+	// First byte is MyMessage::last, the neighbour the packet came from
+	if (len)
+		learn(((uint8_t*)data)[0], _rx);
+	return len;
+}
+
+void MyTransportDual::powerDown() {
+	_radio[0]->powerDown();
+	_radio[1]->powerDown();
+}
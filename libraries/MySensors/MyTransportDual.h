@@ -0,0 +1,72 @@
+/**
+ * The MySensors Arduino library handles the wireless radio link and protocol
+ * between your home built sensors/actuators and HA controller of choice.
+ * The sensors forms a self healing radio network with optional repeaters. Each
+ * repeater and gateway builds a routing tables in EEPROM which keeps track of the
+ * network topology allowing messages to be routed to nodes.
+ *
+ * Created by Henrik Ekblad <henrik.ekblad@mysensors.org>
+ * Copyright (C) 2013-2015 Sensnology AB
+ * Full contributor list: https://github.com/mysensors/Arduino/graphs/contributors
+ *
+ * Documentation: http://www.mysensors.org
+ * Support Forum: http://forum.mysensors.org
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * version 2 as published by the Free Software Foundation.
+ */
+
+#ifndef MyTransportDual_h
+#define MyTransportDual_h
+
+#include "MyTransport.h"
+#include <stdint.h>
+
+/**
+ * Runs two radios (e.g. nRF24 and RFM69) as one transport, so a single gateway or
+ * repeater with a single routing table serves nodes on both media.
+ *
+ *   MyTransportNRF24 nrf24(RF24_CE_PIN, RF24_CS_PIN, RF24_PA_LEVEL_GW);
+ *   MyTransportRFM69 rfm69(RFM69_FREQUENCY, RFM69_NETWORKID, 8);  // separate slave select pin
+ *   MyTransportDual transport(nrf24, rfm69);
+ *   MySensor gw(transport);
+ *
+ * The medium of each neighbour is learnt from the packets it sends (the first byte of a
+ * packet is MyMessage::last). Packets to neighbours not heard from yet are tried on the
+ * primary radio first, then on the secondary. If a send on the learnt medium fails, the
+ * other radio is tried (and learnt if it works). Broadcasts go out on both. The MTU is the
+ * smaller one of the two radios.
+ *
+ * Both radios share the SPI bus and the RFM69 reads frames from its interrupt handler, so the
+ * nRF24 driver uses SPI transactions and the RFM69 driver registers its interrupt with
+ * SPI.usingInterrupt() (needs an Arduino core with SPI transactions).
+ */
+class MyTransportDual : public MyTransport
+{
+public:
+	MyTransportDual(MyTransport &primary, MyTransport &secondary);
+	bool init();
+	void setAddress(uint8_t address);
+	uint8_t getAddress();
+	bool send(uint8_t to, const void* data, uint8_t len);
+	uint8_t getMTU();
+	// Only forwarded to the radio of the node
+	bool preloadAck(uint8_t to, const void* data, uint8_t len);
+	// Channel handling only applies to the primary radio
+	bool setChannel(uint8_t channel);
+	uint8_t scanChannel(uint8_t channel, uint8_t samples);
+	bool available(uint8_t *to);
+	uint8_t receive(void* data);
+	void powerDown();
+private:
+	MyTransport* _radio[2];
+	uint8_t _rx; // Radio that reported the last available() packet, polled last next time
+	uint8_t _known[32]; // Bit per node, medium of node is known
+	uint8_t _secondary[32]; // Bit per node, node lives on the secondary radio
+
+	uint8_t mediumOf(uint8_t node);
+	void learn(uint8_t node, uint8_t medium);
+};
+
+#endif
@@ -20,12 +20,17 @@
 #include "MyTransport.h"
 #include "MyTransportNRF24.h"
 
+#ifdef RF24_IRQ_NUM
+MyTransportNRF24* MyTransportNRF24::_instance;
+#endif
+
 MyTransportNRF24::MyTransportNRF24(uint8_t ce, uint8_t cs, uint8_t paLevel, uint8_t channel, rf24_datarate_e datarate)
 	:
 	MyTransport(),
 	rf24(ce, cs),
 	_paLevel(paLevel),
 	_channel(channel),
+	_defaultChannel(channel),
 	_datarate(datarate)
 {
 }
@@ -49,14 +54,41 @@ bool MyTransportNRF24::init() {
 
 	// All nodes listen to broadcast pipe (for FIND_PARENT_RESPONSE messages)
 	rf24.openReadingPipe(BROADCAST_PIPE, TO_ADDR(BROADCAST_ADDRESS));
+
+#ifdef MY_ACK_PAYLOAD_FEATURE
+	_ackOutLen = 0;
+#ifndef RF24_IRQ_NUM
+	_ackInLen = 0;
+#endif
+#endif
+
+#ifdef RF24_IRQ_NUM
+	_rxHead = 0;
+	_rxCount = 0;
+	_rxLocked = false;
+	_rxPending = false;
+	_instance = this;
+	// Only RX_DR should pull the IRQ line, TX results are polled by send()
+	rf24.maskIRQ(true, true, false);
+#if defined(SPI_HAS_TRANSACTION) && !defined(ARDUINO_ARCH_ESP8266)
+	// The ISR uses SPI, keep it away from transactions of other SPI devices (flash, Ethernet)
+	SPI.usingInterrupt(RF24_IRQ_NUM);
+#endif
+	attachInterrupt(RF24_IRQ_NUM, isr, FALLING);
+#endif
 	return true;
 }
 
 void MyTransportNRF24::setAddress(uint8_t address) {
+	lock();
 	_address = address;
+#ifndef MY_ACK_PAYLOAD_FEATURE
 	rf24.openReadingPipe(WRITE_PIPE, TO_ADDR(address));
+#endif
 	rf24.openReadingPipe(CURRENT_NODE_PIPE, TO_ADDR(address));
 	rf24.startListening();
+	loadAckPayload();
+	unlock();
 }
 
 uint8_t MyTransportNRF24::getAddress() {
@@ -64,32 +96,277 @@ uint8_t MyTransportNRF24::getAddress() {
 }
 
 bool MyTransportNRF24::send(uint8_t to, const void* data, uint8_t len) {
+	lock();
 	// Make sure radio has powered up
 	rf24.powerUp();
 	rf24.stopListening();
 	rf24.openWritingPipe(TO_ADDR(to));
 	bool ok = rf24.write(data, len, to == BROADCAST_ADDRESS);
 	rf24.startListening();
+	loadAckPayload();
+	unlock();
 	return ok;
 }
 
+// Frames to the same destination are pipelined through the TX FIFO without leaving TX mode.
+// At most two frames are in flight: TX_DS is a single latched bit, so when it is seen the
+// FIFO tells whether one or both frames are done (a frame stays in the FIFO until acked).
+uint8_t MyTransportNRF24::sendBatch(MyTransportFrame *frames, uint8_t count) {
+	uint8_t sent = 0;
+	uint8_t i = 0;
+	lock();
+	rf24.powerUp();
+	rf24.stopListening();
+	while (i < count) {
+		uint8_t to = frames[i].to;
+		uint8_t first = i; // Oldest frame in flight
+		rf24.openWritingPipe(TO_ADDR(to));
+		while (true) {
+			while (i < count && frames[i].to == to && i - first < 2) {
+				rf24.startFastWrite(frames[i].data, frames[i].len, to == BROADCAST_ADDRESS);
+				i++;
+			}
+			if (first == i)
+				break;
+			// Same limit as RF24::write() for one frame
+			unsigned long start = millis();
+			bool txOk, txFail, rxReady;
+			do {
+				rf24.whatHappened(txOk, txFail, rxReady);
+			} while (!txOk && !txFail && millis() - start < 75);
+			if (txFail || !txOk) {
+				// Radio stops on MAX_RT (TX_DS too means the first of two frames made it).
+				// Drop the failed frame and requeue the ones behind it.
+				if (txOk && i - first == 2) {
+					frames[first++].ok = true;
+					sent++;
+				}
+				frames[first].ok = false;
+				rf24.flush_tx();
+				i = ++first;
+			} else {
+				uint8_t done = i - first;
+				if (done == 2 && !rf24.txFifoEmpty())
+					done = 1;
+				else if (done == 2)
+					rf24.whatHappened(txOk, txFail, rxReady); // Nothing in flight, drop a TX_DS the second frame may have set meanwhile
+				while (done--) {
+					frames[first++].ok = true;
+					sent++;
+				}
+			}
+		}
+	}
+	rf24.txStandBy();
+	rf24.startListening();
+	loadAckPayload();
+	unlock();
+	return sent;
+}
+
 bool MyTransportNRF24::available(uint8_t *to) {
-	uint8_t pipe = 255;
-	boolean avail = rf24.available(&pipe);
-	(void)avail; //until somebody makes use of 'avail'
-	if (pipe == CURRENT_NODE_PIPE)
+	uint8_t pipe;
+#ifdef RF24_IRQ_NUM
+	if (_rxPending) {
+		// Radio FIFO was left unread (radio busy or queue full), fetch it now
+		lock();
+		unlock();
+	}
+	if (!_rxCount)
+		return false;
+	pipe = _rxQueue[_rxHead].pipe;
+#else
+#ifdef MY_ACK_PAYLOAD_FEATURE
+	if (_ackInLen) {
+		*to = _address;
+		return true;
+	}
+	while (rf24.available(&pipe) && pipe == WRITE_PIPE) {
+		// ACK payloads are fetched right away, they are dropped if meant for another node
+		_ackInLen = readPacket(pipe, _ackIn);
+		if (_ackInLen) {
+			*to = _address;
+			return true;
+		}
+	}
+#endif
+	if (!rf24.available(&pipe))
+		return false;
+#endif
+	if (pipe == CURRENT_NODE_PIPE || pipe == WRITE_PIPE)
 		*to = _address;
 	else if (pipe == BROADCAST_PIPE)
 		*to = BROADCAST_ADDRESS;
-	return (rf24.available() && pipe < 6);
+	return pipe < 6;
 }
 
 uint8_t MyTransportNRF24::receive(void* data) {
+#ifdef RF24_IRQ_NUM
+	if (!_rxCount)
+		return 0;
+	lock();
+	RxEntry *e = &_rxQueue[_rxHead];
+	uint8_t len = e->len;
+	memcpy(data, e->data, len);
+	_rxHead = (_rxHead + 1) % RF24_RX_QUEUE_SIZE;
+	_rxCount--;
+	unlock();
+#else
+#ifdef MY_ACK_PAYLOAD_FEATURE
+	if (_ackInLen) {
+		uint8_t len = _ackInLen;
+		memcpy(data, _ackIn, len);
+		_ackInLen = 0;
+		return len;
+	}
+#endif
+	uint8_t pipe;
+	if (!rf24.available(&pipe))
+		return 0;
+	uint8_t len = readPacket(pipe, (uint8_t *)data);
+#endif
+	return len;
+}
+
+// Fetches the oldest packet from the radio FIFO into buf (32 bytes). Returns 0 if the
+// packet has to be dropped.
+uint8_t MyTransportNRF24::readPacket(uint8_t pipe, uint8_t *buf) {
 	uint8_t len = rf24.getDynamicPayloadSize();
-	rf24.read(data, len);
+	if (len == 0)
+		return 0; // Corrupt packet, RX FIFO has been flushed
+	rf24.read(buf, len);
+#ifdef MY_ACK_PAYLOAD_FEATURE
+	if (pipe == WRITE_PIPE) {
+		// ACK payload from our parent, first byte is the node it was meant for
+		if (buf[0] != _address)
+			return 0;
+		memmove(buf, buf + 1, --len);
+	} else if (pipe == CURRENT_NODE_PIPE && _ackOutLen) {
+		// The preloaded payload went out with the ACK of this packet. The first byte of a
+		// MySensors packet is the node that transmitted it (MyMessage::last).
+		if (buf[0] == _ackOut[0])
+			_ackOutLen = 0;
+		else
+			loadAckPayload(); // Picked up (and dropped) by another child, load it again
+	}
+#else
+	(void)pipe;
+#endif
 	return len;
 }
 
+bool MyTransportNRF24::preloadAck(uint8_t to, const void* data, uint8_t len) {
+#ifdef MY_ACK_PAYLOAD_FEATURE
+	if (len >= sizeof(_ackOut))
+		return false;
+	lock();
+	_ackOut[0] = to;
+	memcpy(_ackOut + 1, data, len);
+	_ackOutLen = len + 1;
+	loadAckPayload();
+	unlock();
+	return true;
+#else
+	(void)to;
+	(void)data;
+	(void)len;
+	return false;
+#endif
+}
+
+bool MyTransportNRF24::setChannel(uint8_t channel) {
+	if (channel == CHANNEL_DEFAULT)
+		channel = _defaultChannel;
+	if (channel > RF24_MAX_CHANNEL)
+		return false;
+	lock();
+	_channel = channel;
+	rf24.stopListening();
+	rf24.setChannel(channel);
+	rf24.startListening();
+	loadAckPayload();
+	unlock();
+	return true;
+}
+
+uint8_t MyTransportNRF24::scanChannel(uint8_t channel, uint8_t samples) {
+	if (channel > RF24_MAX_CHANNEL)
+		return 0xFF;
+	uint8_t busy = 0;
+	lock();
+	rf24.stopListening();
+	rf24.setChannel(channel);
+	while (samples--) {
+		rf24.startListening();
+		delayMicroseconds(128);
+		rf24.stopListening();
+		// RPD latches if a signal above -64dBm was seen while listening
+		if (rf24.testRPD())
+			busy++;
+	}
+	rf24.setChannel(_channel);
+	rf24.startListening();
+	loadAckPayload();
+	unlock();
+	return busy;
+}
+
+// (Re)loads the pending ACK payload. The radio flushes the TX FIFO whenever it switches
+// between RX and TX mode so this is needed after every send.
+void MyTransportNRF24::loadAckPayload() {
+#ifdef MY_ACK_PAYLOAD_FEATURE
+	rf24.flush_tx();
+	if (_ackOutLen)
+		rf24.writeAckPayload(CURRENT_NODE_PIPE, _ackOut, _ackOutLen);
+#endif
+}
+
 void MyTransportNRF24::powerDown() {
+	lock();
 	rf24.powerDown();
+	unlock();
+}
+
+#ifdef RF24_IRQ_NUM
+void MyTransportNRF24::isr() {
+	if (_instance->_rxLocked)
+		_instance->_rxPending = true;
+	else
+		_instance->drainRx();
+}
+
+// Moves all packets waiting in the radio FIFO to the RAM queue
+void MyTransportNRF24::drainRx() {
+	uint8_t pipe;
+	_rxPending = false;
+	while (rf24.available(&pipe)) {
+		if (_rxCount >= RF24_RX_QUEUE_SIZE) {
+			// No room, leave the rest in the radio until receive() frees an entry
+			_rxPending = true;
+			break;
+		}
+		RxEntry *e = &_rxQueue[(_rxHead + _rxCount) % RF24_RX_QUEUE_SIZE];
+		e->len = readPacket(pipe, e->data);
+		if (e->len == 0)
+			continue;
+		e->pipe = pipe;
+		_rxCount++;
+	}
+}
+
+// Keeps the ISR away from SPI while the radio is used from the main code
+void MyTransportNRF24::lock() {
+	_rxLocked = true;
+}
+
+void MyTransportNRF24::unlock() {
+	// The IRQ line stays low until the FIFO has been read, so an IRQ missed
+	// while locked must be served here
+	if (_rxPending)
+		drainRx();
+	_rxLocked = false;
 }
+#else
+void MyTransportNRF24::lock() {}
+void MyTransportNRF24::unlock() {}
+#endif
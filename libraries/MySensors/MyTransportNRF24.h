@@ -32,6 +32,8 @@
 #define CURRENT_NODE_PIPE ((uint8_t)1)
 #define BROADCAST_PIPE ((uint8_t)2)
 
+#define RF24_MAX_CHANNEL 125
+
 class MyTransportNRF24 : public MyTransport
 { 
 public:
@@ -40,6 +42,10 @@ public:
 	void setAddress(uint8_t address);
 	uint8_t getAddress();
 	bool send(uint8_t to, const void* data, uint8_t len);
+	uint8_t sendBatch(MyTransportFrame *frames, uint8_t count);
+	bool preloadAck(uint8_t to, const void* data, uint8_t len);
+	bool setChannel(uint8_t channel);
+	uint8_t scanChannel(uint8_t channel, uint8_t samples);
 	bool available(uint8_t *to);
 	uint8_t receive(void* data);
 	void powerDown();
@@ -48,7 +54,35 @@ private:
 	uint8_t _address;
 	uint8_t _paLevel;
 	uint8_t _channel;
+	uint8_t _defaultChannel;
 	rf24_datarate_e _datarate;
+#ifdef MY_ACK_PAYLOAD_FEATURE
+	uint8_t _ackOut[32]; // Destination node followed by the packet
+	uint8_t _ackOutLen;
+#ifndef RF24_IRQ_NUM
+	uint8_t _ackIn[32]; // Received ACK payload, waiting for receive()
+	uint8_t _ackInLen;
+#endif
+#endif
+#ifdef RF24_IRQ_NUM
+	struct RxEntry {
+		uint8_t pipe;
+		uint8_t len;
+		uint8_t data[32];
+	};
+	RxEntry _rxQueue[RF24_RX_QUEUE_SIZE];
+	volatile uint8_t _rxHead; // Oldest queued packet
+	volatile uint8_t _rxCount;
+	volatile bool _rxLocked; // Main code is talking to the radio, ISR must not touch SPI
+	volatile bool _rxPending; // IRQ fired while locked (or queue was full)
+	static MyTransportNRF24* _instance;
+	static void isr();
+	void drainRx();
+#endif
+	void lock();
+	void unlock();
+	uint8_t readPacket(uint8_t pipe, uint8_t *buf);
+	void loadAckPayload();
 };
 
 #endif
@@ -19,6 +19,7 @@
 
 #include "MyTransport.h"
 #include "MyTransportRFM69.h"
+#include "MyMessage.h"
 
 MyTransportRFM69::MyTransportRFM69(uint8_t freqBand, uint8_t networkId, uint8_t slaveSelectPin, uint8_t interruptPin, bool isRFM69HW, uint8_t interruptNum)
 	:
@@ -34,6 +35,9 @@ bool MyTransportRFM69::init() {
 	radio.initialize(_freqBand, _address, _networkId);
 #ifdef RFM69_ENABLE_ENCRYPTION
     radio.encrypt(RFM69_ENCRYPTKEY);
+#endif
+#ifdef RFM69_ATC_TARGET_RSSI
+	radio.enableAutoPower(RFM69_ATC_TARGET_RSSI);
 #endif
 	return true;
 }
@@ -48,24 +52,54 @@ uint8_t MyTransportRFM69::getAddress() {
 }
 
 bool MyTransportRFM69::send(uint8_t to, const void* data, uint8_t len) {
-	return radio.sendWithRetry(to,data,len);
+	// Let a packet started with startSend() finish first
+	while (radio.sendStatus() == RF69_TX_BUSY);
+	if (!startSend(to, data, len))
+		return false;
+	uint8_t status;
+	while ((status = sendStatus()) == MY_TX_BUSY);
+	return status == MY_TX_OK;
+}
+
+uint8_t MyTransportRFM69::getMTU() {
+	return RF69_MAX_DATA_LEN;
+}
+
+bool MyTransportRFM69::startSend(uint8_t to, const void* data, uint8_t len) {
+	// Broadcasts are not acked
+	return radio.startSend(to, data, len, to != BROADCAST_ADDRESS);
+}
+
+uint8_t MyTransportRFM69::sendStatus() {
+	switch (radio.sendStatus()) {
+		case RF69_TX_BUSY: return MY_TX_BUSY;
+		case RF69_TX_OK: return MY_TX_OK;
+		case RF69_TX_FAILED: return MY_TX_FAILED;
+		default: return MY_TX_IDLE;
+	}
 }
 
 bool MyTransportRFM69::available(uint8_t *to) {
+	// Move a background transmission (e.g. an ACK) forward. Frames received meanwhile stay queued in the driver.
+	radio.sendStatus();
+	if (!radio.receiveDone())
+		return false;
 	if (radio.TARGETID == BROADCAST_ADDRESS)
 		*to = BROADCAST_ADDRESS;
 	else
 		*to = _address;
-	return radio.receiveDone();
+	return true;
 }
 
 uint8_t MyTransportRFM69::receive(void* data) {
-	memcpy(data,(const void *)radio.DATA, radio.DATALEN);
-	// Send ack back if this message wasn't a broadcast
-	if (radio.TARGETID != RF69_BROADCAST_ADDR)
-		radio.ACKRequested();
-    radio.sendACK();
-	return radio.DATALEN;
+	// Never overflow the message buffer, whatever other nodes send
+	uint8_t len = min(radio.DATALEN, MAX_MESSAGE_LENGTH);
+	memcpy(data,(const void *)radio.DATA, len);
+	// Send ack back if this message wasn't a broadcast. The ACK goes out in the background
+	// (it is dropped if a packet of our own is still in progress, the sender retries).
+	if (radio.ACKRequested())
+		radio.startSendACK();
+	return len;
 }	
 
 void MyTransportRFM69::powerDown() {
@@ -35,6 +35,9 @@ public:
 	void setAddress(uint8_t address);
 	uint8_t getAddress();
 	bool send(uint8_t to, const void* data, uint8_t len);
+	uint8_t getMTU();
+	bool startSend(uint8_t to, const void* data, uint8_t len);
+	uint8_t sendStatus();
 	bool available(uint8_t *to);
 	uint8_t receive(void* data);
 	void powerDown();
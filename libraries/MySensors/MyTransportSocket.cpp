@@ -0,0 +1,141 @@
+/**
+ * The MySensors Arduino library handles the wireless radio link and protocol
+ * between your home built sensors/actuators and HA controller of choice.
+ * The sensors forms a self healing radio network with optional repeaters. Each
+ * repeater and gateway builds a routing tables in EEPROM which keeps track of the
+ * network topology allowing messages to be routed to nodes.
+ *
+ * Created by Henrik Ekblad <henrik.ekblad@mysensors.org>
+ * Copyright (C) 2013-2015 Sensnology AB
+ * Full contributor list: https://github.com/mysensors/Arduino/graphs/contributors
+ *
+ * Documentation: http://www.mysensors.org
+ * Support Forum: http://forum.mysensors.org
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * version 2 as published by the Free Software Foundation.
+ */
+
+#ifdef __linux__
+
+#include "MyTransportSocket.h"
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <errno.h>
+#include <string.h>
+#include <stdio.h>
+#include <stddef.h>
+
+// Fills in the abstract socket name of node, returns the address length
+static socklen_t socketName(struct sockaddr_un *addr, const char* network, uint8_t node) {
+	memset(addr, 0, sizeof(*addr));
+	addr->sun_family = AF_UNIX;
+	// Leading \0 (left by memset) selects the abstract namespace
+	int len = snprintf(addr->sun_path + 1, sizeof(addr->sun_path) - 1, "%s/%d", network, node);
+	if (len > (int)sizeof(addr->sun_path) - 2)
+		len = sizeof(addr->sun_path) - 2;
+	return offsetof(struct sockaddr_un, sun_path) + 1 + len;
+}
+
+MyTransportSocket::MyTransportSocket(const char* network)
+	:
+	MyTransport(),
+	_network(network),
+	_fd(-1),
+	_address(AUTO),
+	_rxLen(0)
+{
+}
+
+bool MyTransportSocket::init() {
+	// Unbound until setAddress(), which is enough for sending
+	_fd = socket(AF_UNIX, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+	return _fd >= 0;
+}
+
+bool MyTransportSocket::bindAddress(uint8_t address) {
+	// A bound socket can't be renamed, replace it
+	int fd = socket(AF_UNIX, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+	if (fd < 0)
+		return false;
+	struct sockaddr_un addr;
+	socklen_t len = socketName(&addr, _network, address);
+	if (bind(fd, (struct sockaddr*)&addr, len) < 0) {
+		close(fd);
+		return false;
+	}
+	if (_fd >= 0)
+		close(_fd);
+	_fd = fd;
+	_rxLen = 0;
+	return true;
+}
+
+void MyTransportSocket::setAddress(uint8_t address) {
+	if (!bindAddress(address))
+		fprintf(stderr, "MyTransportSocket: %s/%d is taken\n", _network, address);
+	_address = address;
+}
+
+uint8_t MyTransportSocket::getAddress() {
+	return _address;
+}
+
+bool MyTransportSocket::sendTo(uint8_t node, const uint8_t* packet, uint8_t len, uint8_t retries) {
+	struct sockaddr_un addr;
+	socklen_t addrLen = socketName(&addr, _network, node);
+	// Fails (like a missing ACK) if nobody holds the id or its queue stays full
+	while (sendto(_fd, packet, len, MSG_DONTWAIT, (struct sockaddr*)&addr, addrLen) != len) {
+		if (errno != EAGAIN || !retries--)
+			return false;
+		// Queue full, retransmit later like the radio does
+		usleep(MY_SOCKET_RETRY_DELAY_US);
+	}
+	return true;
+}
+
+bool MyTransportSocket::send(uint8_t to, const void* data, uint8_t len) {
+	if (_fd < 0 || len > MY_SOCKET_MTU)
+		return false;
+	uint8_t packet[MY_SOCKET_MTU + 1];
+	packet[0] = to;
+	memcpy(packet + 1, data, len);
+	if (to != BROADCAST_ADDRESS)
+		return sendTo(to, packet, len + 1, MY_SOCKET_RETRIES);
+	// Includes AUTO (255), nodes without an id wait there for I_ID_RESPONSE and parent replies
+	for (uint16_t node = 0; node <= BROADCAST_ADDRESS; node++) {
+		if (node != _address)
+			sendTo(node, packet, len + 1, 0);
+	}
+	return true;
+}
+
+uint8_t MyTransportSocket::getMTU() {
+	return MY_SOCKET_MTU;
+}
+
+bool MyTransportSocket::available(uint8_t *to) {
+	if (!_rxLen) {
+		ssize_t n = recv(_fd, _rxBuf, sizeof(_rxBuf), MSG_DONTWAIT);
+		if (n < 2)
+			return false;
+		_rxLen = n - 1;
+	}
+	*to = _rxBuf[0] == BROADCAST_ADDRESS ? BROADCAST_ADDRESS : _address;
+	return true;
+}
+
+uint8_t MyTransportSocket::receive(void* data) {
+	uint8_t len = _rxLen;
+	memcpy(data, _rxBuf + 1, len);
+	_rxLen = 0;
+	return len;
+}
+
+void MyTransportSocket::powerDown() {
+	// Nothing to save, packets are queued by the kernel meanwhile
+}
+
+#endif
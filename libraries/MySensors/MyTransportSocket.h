@@ -0,0 +1,72 @@
+/**
+ * The MySensors Arduino library handles the wireless radio link and protocol
+ * between your home built sensors/actuators and HA controller of choice.
+ * The sensors forms a self healing radio network with optional repeaters. Each
+ * repeater and gateway builds a routing tables in EEPROM which keeps track of the
+ * network topology allowing messages to be routed to nodes.
+ *
+ * Created by Henrik Ekblad <henrik.ekblad@mysensors.org>
+ * Copyright (C) 2013-2015 Sensnology AB
+ * Full contributor list: https://github.com/mysensors/Arduino/graphs/contributors
+ *
+ * Documentation: http://www.mysensors.org
+ * Support Forum: http://forum.mysensors.org
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * version 2 as published by the Free Software Foundation.
+ */
+
+#ifndef MyTransportSocket_h
+#define MyTransportSocket_h
+
+#include "MyConfig.h"
+#include "MyTransport.h"
+#include <stdint.h>
+
+// Largest packet accepted (and received) by the socket transport
+#define MY_SOCKET_MTU MY_MAX_MESSAGE_LENGTH
+// Retransmissions of a unicast while the receive queue of the destination is full
+// (only net.unix.max_dgram_qlen packets, 10 by default), and the delay between them
+#define MY_SOCKET_RETRIES 15
+#define MY_SOCKET_RETRY_DELAY_US 250
+// Default network name. Processes using the same name talk to each other.
+#define MY_SOCKET_NETWORK "mysensors"
+
+/**
+ * Software "radio" for Linux hosts, e.g. to run hundreds of simulated nodes against a
+ * gateway process for load testing. Not compiled on the microcontrollers.
+ *
+ * Every node binds a Unix datagram socket in the abstract namespace named
+ * "<network>/<node id>", so there are no files to clean up. A unicast send() fails like a
+ * missing radio ACK when no process holds the destination id, or its receive queue stays full
+ * for MY_SOCKET_RETRIES retransmissions.
+ * Broadcasts are delivered to every id that is bound (AUTO included), except our own.
+ *
+ * Only one process at a time can hold an id, including AUTO (255), so give software
+ * nodes static ids when starting many of them at once.
+ */
+class MyTransportSocket : public MyTransport
+{
+public:
+	MyTransportSocket(const char* network=MY_SOCKET_NETWORK);
+	bool init();
+	void setAddress(uint8_t address);
+	uint8_t getAddress();
+	bool send(uint8_t to, const void* data, uint8_t len);
+	uint8_t getMTU();
+	bool available(uint8_t *to);
+	uint8_t receive(void* data);
+	void powerDown();
+private:
+	const char* _network;
+	int _fd;
+	uint8_t _address;
+	uint8_t _rxBuf[MY_SOCKET_MTU + 1]; // Destination followed by the packet
+	uint8_t _rxLen; // Length of packet in _rxBuf (0 = none)
+
+	bool bindAddress(uint8_t address);
+	bool sendTo(uint8_t node, const uint8_t* packet, uint8_t len, uint8_t retries);
+};
+
+#endif
@@ -32,7 +32,7 @@ void setup()
 { 
   Serial.begin(BAUD_RATE);
   Serial.println("Started clearing. Please wait...");
-  for (int i=0;i<512;i++) {
+  for (int i=0;i<=E2END;i++) {
     EEPROM.write(i, 0xff);
   }
   Serial.println("Clering done. You're ready to go!");
@@ -86,6 +86,51 @@ void checkInclusionFinished() {
   }
 }
 
+// Samples every radio channel 15 times and reports the result as one hex digit
+// (number of samples with traffic) per channel: "<first channel>:<digits>"
+void surveyChannels(MySensor &gw) {
+  char counts[65];
+  uint8_t channel = 0;
+  uint8_t n;
+  do {
+    n = 0;
+    while (n < sizeof(counts) - 1) {
+      uint8_t busy = gw.scanChannel(channel, 15);
+      if (busy == 0xFF)
+        break; // No more channels (or not supported by radio)
+      counts[n++] = busy < 10 ? '0' + busy : 'A' + busy - 10;
+      channel++;
+    }
+    counts[n] = 0;
+    if (n)
+      serial(PSTR("0;0;%d;0;%d;%d:%s\n"), C_INTERNAL, I_CHANNEL_SURVEY, channel - n, counts);
+  } while (n == sizeof(counts) - 1);
+}
+
+#ifdef MY_NODE_TABLE
+// Lists the node table, one message per node: "<node>,<parent>,<distance>,<heartbeat>,<seconds since seen>,<alive>"
+// Parent and distance are 255 when not known.
+void reportNodeTable(MySensor &gw) {
+  for (uint8_t i = 0; i < MY_NODE_TABLE_SIZE; i++) {
+    const NodeInfo *node = gw.getNodeInfo(i);
+    if (node != NULL) {
+      serial(PSTR("0;0;%d;0;%d;%d,%d,%d,%u,%lu,%d\n"), C_INTERNAL, I_NODE_TABLE, node->nodeId, node->parent,
+        gw.getNodeDistance(node->nodeId), node->heartbeat, (millis() - node->lastSeen) / 1000, node->alive);
+    }
+  }
+}
+#endif
+
+#ifdef MY_NODE_STATS
+// Reports the statistics of the gateway itself, like a node answers I_STATS
+void reportStats(MySensor &gw) {
+  NodeStats stats = gw.getStats();
+  MyMessage report;
+  report.set(&stats, sizeof(NodeStats));
+  serial(PSTR("0;0;%d;0;%d;%s\n"), C_INTERNAL, I_STATS, report.getString(convBuf));
+}
+#endif
+
 void parseAndSend(MySensor &gw, char *commandBuffer) {
   boolean ok;
   MyMessage &msg = gw.getLastMessage();
@@ -101,6 +146,22 @@ void parseAndSend(MySensor &gw, char *commandBuffer) {
       } else if (msg.type == I_INCLUSION_MODE) {
         // Request to change inclusion mode
         setInclusionMode(atoi(msg.data) == 1);
+      } else if (msg.type == I_CHANNEL_SURVEY) {
+        // Request to report how busy the radio channels are
+        surveyChannels(gw);
+      } else if (msg.type == I_CHANNEL_CHANGE) {
+        // Request to move the network to another channel
+        gw.changeChannel(atoi(msg.data));
+#ifdef MY_NODE_TABLE
+      } else if (msg.type == I_NODE_TABLE) {
+        // Request to list the nodes known by the gateway
+        reportNodeTable(gw);
+#endif
+#ifdef MY_NODE_STATS
+      } else if (msg.type == I_STATS) {
+        // Request for the statistics of the gateway
+        reportStats(gw);
+#endif
       }
     } else {
       #ifdef WITH_LEDS_BLINKING
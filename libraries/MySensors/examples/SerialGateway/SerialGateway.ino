@@ -41,6 +41,7 @@
 #include <MySigningNone.h>
 #include <MyTransportRFM69.h>
 #include <MyTransportNRF24.h>
+#include <MyTransportDual.h>
 #include <MyHwATMega328.h>
 #include <MySigningAtsha204Soft.h>
 #include <MySigningAtsha204.h>
@@ -62,6 +63,11 @@
 MyTransportNRF24 transport(RF24_CE_PIN, RF24_CS_PIN, RF24_PA_LEVEL_GW);
 //MyTransportRFM69 transport;
 
+// Serve nRF24 and RFM69 nodes from this gateway (give the radios different slave select pins)
+//MyTransportNRF24 nrf24(RF24_CE_PIN, RF24_CS_PIN, RF24_PA_LEVEL_GW);
+//MyTransportRFM69 rfm69(RFM69_FREQUENCY, RFM69_NETWORKID, 8);
+//MyTransportDual transport(nrf24, rfm69);
+
 // Message signing driver (signer needed if MY_SIGNING_FEATURE is turned on in MyConfig.h)
 //MySigningNone signer;
 //MySigningAtsha204Soft signer;
@@ -28,9 +28,16 @@ void RF24::csn(bool mode)
   // CLK:BUS 8Mhz:2Mhz, 16Mhz:4Mhz, or 20Mhz:5Mhz
 #ifdef ARDUINO
 	#if  ( !defined(RF24_TINY) && !defined (__arm__)  && !defined (SOFTSPI)) || defined (CORE_TEENSY)
+		#ifdef SPI_HAS_TRANSACTION
+			// Transactions mask interrupts registered with SPI.usingInterrupt(), e.g. the one
+			// of a second radio whose handler uses SPI (MyTransportDual)
+			if (mode == LOW)
+				_SPI.beginTransaction(SPISettings(8000000, MSBFIRST, SPI_MODE0));
+		#else
  			_SPI.setBitOrder(MSBFIRST);
   			_SPI.setDataMode(SPI_MODE0);
 			_SPI.setClockDivider(SPI_CLOCK_DIV2);
+		#endif
 	#endif
 #endif
 
@@ -51,6 +58,10 @@ void RF24::csn(bool mode)
 	}		
 #elif !defined  (__arm__) || defined (CORE_TEENSY)
 	digitalWrite(csn_pin,mode);		
+	#if defined(ARDUINO) && defined(SPI_HAS_TRANSACTION) && !defined(SOFTSPI)
+	if (mode == HIGH)
+		_SPI.endTransaction();
+	#endif
 #endif
 
 }
@@ -91,8 +102,24 @@ uint8_t RF24::read_register(uint8_t reg, uint8_t* buf, uint8_t len)
 
 /****************************************************************************/
 
+int8_t RF24::shadow_index(uint8_t reg)
+{
+  if ( reg <= RF_SETUP )
+    return reg;
+  if ( reg >= RX_PW_P0 && reg <= RX_PW_P5 )
+    return reg - RX_PW_P0 + 7;
+  if ( reg == DYNPD || reg == FEATURE )
+    return reg - DYNPD + 13;
+  return -1;
+}
+
+/****************************************************************************/
+
 uint8_t RF24::read_register(uint8_t reg)
 {
+  int8_t idx = shadow_index(reg);
+  if ( idx >= 0 && ( shadow_valid & ( 1UL << idx ) ) )
+    return reg_shadow[idx];
 
   #if defined (__arm__) && !defined ( CORE_TEENSY )
   _SPI.transfer(csn_pin, R_REGISTER | ( REGISTER_MASK & reg ) , SPI_CONTINUE);
@@ -105,6 +132,10 @@ uint8_t RF24::read_register(uint8_t reg)
   csn(HIGH);
   #endif
 
+  if ( idx >= 0 ) {
+    reg_shadow[idx] = result;
+    shadow_valid |= 1UL << idx;
+  }
   return result;
 }
 
@@ -114,6 +145,21 @@ uint8_t RF24::write_register(uint8_t reg, const uint8_t* buf, uint8_t len)
 {
   uint8_t status;
 
+  // Full width addresses of pipe 0 and TX are shadowed, they are rewritten for every packet sent
+  int8_t idx = -1;
+  if ( len == 5 && ( reg == RX_ADDR_P0 || reg == TX_ADDR ) ) {
+    uint8_t bit = reg == TX_ADDR ? 16 : 15;
+    idx = reg == TX_ADDR ? 20 : 15;
+    if ( ( shadow_valid & ( 1UL << bit ) ) && !memcmp( &reg_shadow[idx], buf, len ) )
+      return get_status();
+    memcpy( &reg_shadow[idx], buf, len );
+    shadow_valid |= 1UL << bit;
+  } else if ( reg == RX_ADDR_P0 ) {
+    shadow_valid &= ~( 1UL << 15 );
+  } else if ( reg == TX_ADDR ) {
+    shadow_valid &= ~( 1UL << 16 );
+  }
+
   #if defined (__arm__) && !defined ( CORE_TEENSY )
   	status = _SPI.transfer(csn_pin, W_REGISTER | ( REGISTER_MASK & reg ), SPI_CONTINUE );
     while ( --len){
@@ -140,6 +186,14 @@ uint8_t RF24::write_register(uint8_t reg, uint8_t value)
 {
   uint8_t status;
 
+  int8_t idx = shadow_index(reg);
+  if ( idx >= 0 ) {
+    if ( ( shadow_valid & ( 1UL << idx ) ) && reg_shadow[idx] == value )
+      return get_status(); // No change, skip the write
+    reg_shadow[idx] = value;
+    shadow_valid |= 1UL << idx;
+  }
+
 #ifdef DEBUG
   Serial.print(F("write_register(")); print_hex(reg, true); Serial.print(F(",")); print_hex(value, true); Serial.println(F(")")); 
 #endif
@@ -378,7 +432,7 @@ void RF24::print_address_register(uint8_t reg, uint8_t qty)
 
 RF24::RF24(uint8_t _cepin, uint8_t _cspin):
   ce_pin(_cepin), csn_pin(_cspin), p_variant(false),
-  payload_size(32), dynamic_payloads_enabled(false), addr_width(5)//,pipe0_reading_address(0)
+  payload_size(32), dynamic_payloads_enabled(false), addr_width(5), shadow_valid(0)//,pipe0_reading_address(0)
 {
 }
 
@@ -476,6 +530,9 @@ void RF24::printDetails(void)
 
 void RF24::begin(void)
 {
+  // Radio may have been configured before a reset of the MCU, trust nothing
+  shadow_valid = 0;
+
   // Initialize pins
   if (ce_pin != csn_pin) pinMode(ce_pin,OUTPUT);
 
@@ -490,7 +547,12 @@ void RF24::begin(void)
     if (ce_pin != csn_pin) pinMode(csn_pin,OUTPUT);
     _SPI.begin();
     ce(LOW);
+    #if defined (RF24_TINY)
   	csn(HIGH);
+    #else
+    // Not csn(HIGH), that would end an SPI transaction which was never begun
+    digitalWrite(csn_pin, HIGH);
+    #endif
   #endif
 
   // Must allow the radio time to settle else configuration bits will not necessarily stick.
@@ -819,6 +881,11 @@ bool RF24::rxFifoFull(){
 }
 /****************************************************************************/
 
+bool RF24::txFifoEmpty(){
+	return read_register(FIFO_STATUS) & _BV(TX_EMPTY);
+}
+/****************************************************************************/
+
 bool RF24::txStandBy(){
     #if defined (FAILURE_HANDLING)
 		uint32_t timeout = millis();
@@ -938,8 +1005,9 @@ void RF24::read( void* buf, uint8_t len ){
   // Fetch the payload
   read_payload( buf, len );
 
-  //Clear the two possible interrupt flags with one command
-  write_register(RF24_STATUS,_BV(RX_DR) | _BV(MAX_RT) | _BV(TX_DS) );
+  // Only clear RX_DR, TX_DS/MAX_RT belong to a transmission that may be polled elsewhere
+  // (read() is also called from the IRQ handler of MyTransportNRF24)
+  write_register(RF24_STATUS,_BV(RX_DR) );
 
 }
 
@@ -1083,6 +1151,9 @@ void RF24::toggle_features(void)
   _SPI.transfer( 0x73 );
   csn(HIGH);
   #endif
+
+  // On non plus chips the feature registers only become accessible now
+  shadow_valid &= ~( ( 1UL << shadow_index(DYNPD) ) | ( 1UL << shadow_index(FEATURE) ) );
 }
 
 /****************************************************************************/
@@ -1267,7 +1338,8 @@ bool RF24::setDataRate(rf24_datarate_e speed)
   }
   write_register(RF_SETUP,setup);
 
-  // Verify our result
+  // Verify our result. Bypass the shadow copy, the chip may have refused the value.
+  shadow_valid &= ~( 1UL << shadow_index(RF_SETUP) );
   if ( read_register(RF_SETUP) == setup )
   {
     result = true;
@@ -62,6 +62,8 @@ private:
   uint8_t addr_width; /**< The address width to use - 3,4 or 5 bytes. */
   uint32_t lastAvailableCheck; /**< Limits the amount of time between reading data, only when switching between modes */
   boolean listeningStarted; /**< Var for delaying available() after start listening */
+  uint8_t reg_shadow[25]; /**< Copies of the configuration registers and the 5 byte RX_ADDR_P0/TX_ADDR, see shadow_index() */
+  uint32_t shadow_valid; /**< One bit per entry of reg_shadow that holds the current register value */
   
 public:
 
@@ -232,6 +234,12 @@ public:
    */
   bool rxFifoFull();
 
+  /**
+   * Check if all payloads of the TX FIFO have been sent (and acked if requested)
+   * @return True if the TX FIFO is empty
+   */
+  bool txFifoEmpty();
+
   /**
    * Enter low-power mode
    *
@@ -887,6 +895,18 @@ private:
    */
   uint8_t write_register(uint8_t reg, uint8_t value);
 
+  /**
+   * Position of a single byte configuration register in the shadow copy
+   *
+   * Registers that are only changed by the MCU (CONFIG - RF_SETUP, RX_PW_Px,
+   * DYNPD and FEATURE) are shadowed in RAM. Reads of these are served from RAM
+   * and writes that would not change the value are skipped.
+   *
+   * @param reg Which register. Use constants from nRF24L01.h
+   * @return Index into reg_shadow (and bit in shadow_valid), -1 if not shadowed
+   */
+  static int8_t shadow_index(uint8_t reg);
+
   /**
    * Write the transmit payload
    *
@@ -43,6 +43,23 @@ volatile byte RFM69::ACK_REQUESTED;
 volatile byte RFM69::ACK_RECEIVED; /// Should be polled immediately after sending a packet with ACK request
 volatile int RFM69::RSSI; //most accurate RSSI during reception (closest to the reception)
 RFM69* RFM69::selfPointer;
+volatile bool RFM69::_frameSent;
+RFM69Frame RFM69::_rxQueue[RFM69_RX_QUEUE_SIZE];
+volatile byte RFM69::_rxHead;
+volatile byte RFM69::_rxCount;
+volatile bool RFM69::_ackPending;
+volatile byte RFM69::_ackSender;
+volatile int RFM69::_ackRSSI;
+
+// internal states of the background transmission (besides RF69_TX_IDLE/OK/FAILED)
+#define RF69_TXS_CSMA         4 // waiting for a free channel
+#define RF69_TXS_SENDING      5 // frame in the radio, interruptHandler() sets _frameSent when done
+#define RF69_TXS_WAIT_ACK     6 // listening for the ACK
+
+// control byte
+#define RF69_CTL_SENDACK      0x80
+#define RF69_CTL_REQACK       0x40
+#define RF69_CTL_RSSI         0x20 // ACK request: please return the RSSI. ACK: first data byte is -RSSI.
 
 bool RFM69::initialize(byte freqBand, byte nodeID, byte networkID)
 {
@@ -103,6 +120,10 @@ bool RFM69::initialize(byte freqBand, byte nodeID, byte networkID)
   setHighPower(_isRFM69HW); //called regardless if it's a RFM69W or RFM69HW
   setMode(RF69_MODE_STANDBY);
 	while ((readReg(REG_IRQFLAGS1) & RF_IRQFLAGS1_MODEREADY) == 0x00); // Wait for ModeReady
+#if defined(SPI_HAS_TRANSACTION) && !defined(ESP8266)
+  // interruptHandler() uses SPI, mask it during transactions of other SPI devices (nRF24, flash)
+  SPI.usingInterrupt(_interruptNum);
+#endif
   attachInterrupt(_interruptNum, RFM69::isr0, RISING);
 
   selfPointer = this;
@@ -149,7 +170,15 @@ void RFM69::setMode(byte newMode)
 	_mode = newMode;
 }
 
+// Lets a frame already in the radio (e.g. an ACK from startSendACK()) go out first. The rest of a
+// background transmission is dropped, the interrupt that completes it would never come while sleeping.
 void RFM69::sleep() {
+  unsigned long start = millis();
+  while (_txState == RF69_TXS_SENDING && !_frameSent && millis()-start < RF69_TX_LIMIT_MS);
+  if (_txState == RF69_TXS_SENDING && _frameSent && !_txRequestACK)
+    _txState = RF69_TX_OK;
+  else if (_txState >= RF69_TXS_CSMA)
+    _txState = RF69_TX_FAILED;
   setMode(RF69_MODE_SLEEP);
 }
 
@@ -163,13 +192,47 @@ void RFM69::setAddress(byte addr)
 // this results in a "weaker" transmitted signal, and directly results in a lower RSSI at the receiver
 void RFM69::setPowerLevel(byte powerLevel)
 {
-  _powerLevel = powerLevel;
-  writeReg(REG_PALEVEL, (readReg(REG_PALEVEL) & 0xE0) | (_powerLevel > 31 ? 31 : _powerLevel));
+  _powerLevel = powerLevel > 31 ? 31 : powerLevel;
+  writeReg(REG_PALEVEL, (readReg(REG_PALEVEL) & 0xE0) | _powerLevel);
+}
+
+byte RFM69::getPowerLevel()
+{
+  return _powerLevel;
+}
+
+// Automatic transmit power control: ACK requests ask the receiver for the RSSI it measured
+// and the power level is nudged until that RSSI is within RF69_ATC_WINDOW dB of targetRSSI.
+// Receivers answer such requests from any version of this driver, no setup needed there.
+// Pass 0 to disable (power level stays where it is).
+void RFM69::enableAutoPower(int targetRSSI)
+{
+  _targetRSSI = targetRSSI;
+}
+
+// Called when an ACK did not show up (missed), or with the RSSI reported in an ACK (0 if the
+// receiver does not report it, the level is left alone then)
+void RFM69::autoPower(bool missed, int ackRSSI)
+{
+  if (!_targetRSSI)
+    return;
+  int level = _powerLevel;
+  if (missed)
+    level += RF69_ATC_MISS_STEP; // lost ACK, the link may be worse than we think
+  else if (!ackRSSI)
+    return;
+  else if (ackRSSI < _targetRSSI - RF69_ATC_WINDOW)
+    level++;
+  else if (ackRSSI > _targetRSSI + RF69_ATC_WINDOW)
+    level--;
+  level = level < 0 ? 0 : level > 31 ? 31 : level;
+  if (level != _powerLevel)
+    setPowerLevel(level);
 }
 
 bool RFM69::canSend()
 {
-  if (_mode == RF69_MODE_RX && PAYLOADLEN == 0 && readRSSI() < CSMA_LIMIT) //if signal stronger than -100dBm is detected assume channel activity
+  if (_mode == RF69_MODE_RX && readRSSI() < CSMA_LIMIT) //if signal stronger than -100dBm is detected assume channel activity
   {
     setMode(RF69_MODE_STANDBY);
     return true;
@@ -181,7 +244,7 @@ void RFM69::send(byte toAddress, const void* buffer, byte bufferSize, bool reque
 {
   writeReg(REG_PACKETCONFIG2, (readReg(REG_PACKETCONFIG2) & 0xFB) | RF_PACKET2_RXRESTART); // avoid RX deadlocks
   long now = millis();
-  while (!canSend() && millis()-now < RF69_CSMA_LIMIT_MS) receiveDone();
+  while (!canSend() && millis()-now < RF69_CSMA_LIMIT_MS) listen();
   sendFrame(toAddress, buffer, bufferSize, requestACK, false);
 }
 
@@ -205,15 +268,103 @@ bool RFM69::sendWithRetry(byte toAddress, const void* buffer, byte bufferSize, b
         return true;
       }
     }
+    autoPower(true, 0);
     //Serial.print(" RETRY#");Serial.println(i+1);
   }
   return false;
 }
 
+// Starts sending a frame in the background and returns immediately.
+// Progress is made (and the result returned) by calling sendStatus() until it no longer returns RF69_TX_BUSY.
+// Returns false if the previous frame is still in progress.
+bool RFM69::startSend(byte toAddress, const void* buffer, byte bufferSize, bool requestACK, byte retries, byte retryWaitTime) {
+  return startTx(toAddress, buffer, bufferSize, requestACK, false, retries, retryWaitTime);
+}
+
+// Background version of sendACK()
+bool RFM69::startSendACK(const void* buffer, byte bufferSize) {
+  return startTx(SENDERID, buffer, bufferSize, false, true, 0, 0);
+}
+
+bool RFM69::startTx(byte toAddress, const void* buffer, byte bufferSize, bool requestACK, bool sendACK, byte retries, byte retryWaitTime) {
+  if (sendStatus() == RF69_TX_BUSY)
+    return false;
+  if (bufferSize > RF69_MAX_DATA_LEN) bufferSize = RF69_MAX_DATA_LEN;
+  memcpy(_txBuf, buffer, bufferSize);
+  _txLen = bufferSize;
+  _txTo = toAddress;
+  _txRequestACK = requestACK;
+  _txIsACK = sendACK;
+  if (sendACK)
+    _rssiOut = _rssiRequested ? -RSSI : 0;
+  _txRetries = retries;
+  _txRetryWaitTime = retryWaitTime;
+  writeReg(REG_PACKETCONFIG2, (readReg(REG_PACKETCONFIG2) & 0xFB) | RF_PACKET2_RXRESTART); // avoid RX deadlocks
+  _txTimer = millis();
+  _txState = RF69_TXS_CSMA;
+  sendStatus();
+  return true;
+}
+
+// Moves the background transmission forward, returns one of RF69_TX_*
+byte RFM69::sendStatus() {
+  switch (_txState) {
+    case RF69_TXS_CSMA:
+      if (!canSend() && millis()-_txTimer < RF69_CSMA_LIMIT_MS) {
+        listen();
+        return RF69_TX_BUSY;
+      }
+      startFrame(_txTo, _txBuf, _txLen, _txRequestACK, _txIsACK);
+      _txTimer = millis();
+      _txState = RF69_TXS_SENDING;
+      return RF69_TX_BUSY;
+    case RF69_TXS_SENDING:
+      if (!_frameSent) {
+        if (millis()-_txTimer < RF69_TX_LIMIT_MS)
+          return RF69_TX_BUSY;
+        // radio never reported the frame as sent, get it back to RX
+        receiveBegin();
+        _txState = RF69_TX_FAILED;
+        return RF69_TX_FAILED;
+      }
+      if (!_txRequestACK) {
+        _txState = RF69_TX_OK;
+        return RF69_TX_OK;
+      }
+      // interruptHandler() has already put the radio in RX
+      _txTimer = millis();
+      _txState = RF69_TXS_WAIT_ACK;
+      // fall through
+    case RF69_TXS_WAIT_ACK:
+      if (ACKReceived(_txTo)) {
+        _txState = RF69_TX_OK;
+      } else if (millis()-_txTimer >= _txRetryWaitTime) {
+        autoPower(true, 0);
+        if (_txRetries) {
+          _txRetries--;
+          _txTimer = millis();
+          _txState = RF69_TXS_CSMA;
+          return RF69_TX_BUSY;
+        }
+        _txState = RF69_TX_FAILED;
+      } else {
+        return RF69_TX_BUSY;
+      }
+      return _txState;
+    default:
+      return _txState;
+  }
+}
+
 /// Should be polled immediately after sending a packet with ACK request
 bool RFM69::ACKReceived(byte fromNodeID) {
-  if (receiveDone())
-    return (SENDERID == fromNodeID || fromNodeID == RF69_BROADCAST_ADDR) && ACK_RECEIVED;
+  listen();
+  if (_ackPending && (_ackSender == fromNodeID || fromNodeID == RF69_BROADCAST_ADDR))
+  {
+    _ackPending = false;
+    autoPower(false, _ackRSSI);
+    return true;
+  }
   return false;
 }
 
@@ -225,113 +376,154 @@ bool RFM69::ACKRequested() {
 /// Should be called immediately after reception in case sender wants ACK
 void RFM69::sendACK(const void* buffer, byte bufferSize) {
   byte sender = SENDERID;
-  while (!canSend()) receiveDone();
+  _rssiOut = _rssiRequested ? -RSSI : 0;
+  while (!canSend()) listen();
   sendFrame(sender, buffer, bufferSize, false, true);
 }
 
 void RFM69::sendFrame(byte toAddress, const void* buffer, byte bufferSize, bool requestACK, bool sendACK)
+{
+  startFrame(toAddress, buffer, bufferSize, requestACK, sendACK);
+  unsigned long start = millis();
+  while (!_frameSent && millis()-start < RF69_TX_LIMIT_MS); //wait for interruptHandler() to see DIO0 signalling transmission finish
+  if (!_frameSent)
+    receiveBegin();
+}
+
+// Loads the frame and starts the transmitter. interruptHandler() puts the radio back in RX when the frame is sent.
+void RFM69::startFrame(byte toAddress, const void* buffer, byte bufferSize, bool requestACK, bool sendACK)
 {
   setMode(RF69_MODE_STANDBY); //turn off receiver to prevent reception while filling fifo
 	while ((readReg(REG_IRQFLAGS1) & RF_IRQFLAGS1_MODEREADY) == 0x00); // Wait for ModeReady
   writeReg(REG_DIOMAPPING1, RF_DIOMAPPING1_DIO0_00); // DIO0 is "Packet Sent"
-  if (bufferSize > RF69_MAX_DATA_LEN) bufferSize = RF69_MAX_DATA_LEN;
+  // ACKs return the RSSI of the acknowledged frame if it was asked for
+  bool rssi = sendACK ? _rssiOut != 0 : requestACK && _targetRSSI;
+  if (bufferSize > RF69_MAX_DATA_LEN - (sendACK && rssi)) bufferSize = RF69_MAX_DATA_LEN - (sendACK && rssi);
 
 	//write to FIFO
 	select();
 	SPI.transfer(REG_FIFO | 0x80);
-	SPI.transfer(bufferSize + 3);
+	SPI.transfer(bufferSize + 3 + (sendACK && rssi));
 	SPI.transfer(toAddress);
   SPI.transfer(_address);
   
   //control byte
   if (sendACK)
-    SPI.transfer(0x80);
+    SPI.transfer(RF69_CTL_SENDACK | (rssi ? RF69_CTL_RSSI : 0));
   else if (requestACK)
-    SPI.transfer(0x40);
+    SPI.transfer(RF69_CTL_REQACK | (rssi ? RF69_CTL_RSSI : 0));
   else SPI.transfer(0x00);
+  if (sendACK && rssi)
+    SPI.transfer(_rssiOut);
   
 	for (byte i = 0; i < bufferSize; i++)
     SPI.transfer(((byte*)buffer)[i]);
 	unselect();
 
 	/* no need to wait for transmit mode to be ready since its handled by the radio */
+  _frameSent = false;
+  _ackPending = false;
 	setMode(RF69_MODE_TX);
-	while (digitalRead(_interruptPin) == 0); //wait for DIO0 to turn HIGH signalling transmission finish
-  //while (readReg(REG_IRQFLAGS2) & RF_IRQFLAGS2_PACKETSENT == 0x00); // Wait for ModeReady
-  setMode(RF69_MODE_STANDBY);
 }
 
 void RFM69::interruptHandler() {
   //pinMode(4, OUTPUT);
   //digitalWrite(4, 1);
+  if (_mode == RF69_MODE_TX && (readReg(REG_IRQFLAGS2) & RF_IRQFLAGS2_PACKETSENT))
+  {
+    // Frame started by startFrame() is out, listen right away (an ACK may follow)
+    _frameSent = true;
+    receiveBegin();
+    return;
+  }
   if (_mode == RF69_MODE_RX && (readReg(REG_IRQFLAGS2) & RF_IRQFLAGS2_PAYLOADREADY))
   {
-    //RSSI = readRSSI();
+    int rssi = readRSSI(); // still valid, the receiver has not been restarted yet
     setMode(RF69_MODE_STANDBY);
     select();
     SPI.transfer(REG_FIFO & 0x7f);
-    PAYLOADLEN = SPI.transfer(0);
-    PAYLOADLEN = PAYLOADLEN > 66 ? 66 : PAYLOADLEN; //precaution
-    TARGETID = SPI.transfer(0);
-    if(!(_promiscuousMode || TARGETID==_address || TARGETID==RF69_BROADCAST_ADDR)) //match this node's address, or broadcast address or anything in promiscuous mode
-    {
-      PAYLOADLEN = 0;
-      unselect();
-      //digitalWrite(4, 0);
-      return;
-    }
-    DATALEN = PAYLOADLEN - 3;
-    SENDERID = SPI.transfer(0);
-    byte CTLbyte = SPI.transfer(0);
-    
-    ACK_RECEIVED = CTLbyte & 0x80; //extract ACK-requested flag
-    ACK_REQUESTED = CTLbyte & 0x40; //extract ACK-received flag
-    
-    for (byte i= 0; i < DATALEN; i++)
+    byte payloadLen = SPI.transfer(0);
+    payloadLen = payloadLen > 66 ? 66 : payloadLen; //precaution
+    byte target = SPI.transfer(0);
+    if(payloadLen >= 3 && (_promiscuousMode || target==_address || target==RF69_BROADCAST_ADDR)) //match this node's address, or broadcast address or anything in promiscuous mode
     {
-      DATA[i] = SPI.transfer(0);
+      byte sender = SPI.transfer(0);
+      byte ctl = SPI.transfer(0);
+      byte len = payloadLen - 3;
+      if (ctl & RF69_CTL_SENDACK)
+      {
+        _ackRSSI = 0;
+        if ((ctl & RF69_CTL_RSSI) && len)
+        {
+          _ackRSSI = -(int)SPI.transfer(0);
+          len--;
+        }
+        _ackSender = sender;
+        _ackPending = true;
+      }
+      // plain ACKs carry nothing for receiveDone(), frames that do not fit (queue full or
+      // a malformed/foreign frame longer than a slot) are dropped
+      if ((len || !(ctl & RF69_CTL_SENDACK)) && len <= RF69_MAX_DATA_LEN && _rxCount < RFM69_RX_QUEUE_SIZE)
+      {
+        RFM69Frame *frame = &_rxQueue[(_rxHead + _rxCount) % RFM69_RX_QUEUE_SIZE];
+        frame->len = len;
+        frame->sender = sender;
+        frame->target = target;
+        frame->ctl = ctl;
+        frame->rssi = rssi;
+        for (byte i = 0; i < len; i++)
+          frame->data[i] = SPI.transfer(0);
+        _rxCount++;
+      }
     }
-    if (DATALEN<RF69_MAX_DATA_LEN) DATA[DATALEN]=0; //add null at end of string
     unselect();
+    // re-arm right away, the next frame may already be on its way
     setMode(RF69_MODE_RX);
   }
-  RSSI = readRSSI();
   //digitalWrite(4, 0);
 }
 
 void RFM69::isr0() { selfPointer->interruptHandler(); }
 
 void RFM69::receiveBegin() {
-  DATALEN = 0;
-  SENDERID = 0;
-  TARGETID = 0;
-  PAYLOADLEN = 0;
-  ACK_REQUESTED = 0;
-  ACK_RECEIVED = 0;
-  RSSI = 0;
   if (readReg(REG_IRQFLAGS2) & RF_IRQFLAGS2_PAYLOADREADY)
     writeReg(REG_PACKETCONFIG2, (readReg(REG_PACKETCONFIG2) & 0xFB) | RF_PACKET2_RXRESTART); // avoid RX deadlocks
   writeReg(REG_DIOMAPPING1, RF_DIOMAPPING1_DIO0_01); //set DIO0 to "PAYLOADREADY" in receive mode
   setMode(RF69_MODE_RX);
 }
 
+// Makes sure the receiver is on, without touching a transmission in progress
+void RFM69::listen() {
+  if (_mode != RF69_MODE_RX && _mode != RF69_MODE_TX)
+    receiveBegin();
+}
+
+// Fetches the oldest queued frame into DATA/DATALEN/SENDERID/TARGETID/ACK_*/RSSI.
+// The radio keeps receiving, so these fields stay valid until the next successful call.
 bool RFM69::receiveDone() {
-// ATOMIC_BLOCK(ATOMIC_FORCEON)
-// {
-  noInterrupts(); //re-enabled in unselect() via setMode() or via receiveBegin()
-  if (_mode == RF69_MODE_RX && PAYLOADLEN>0)
+  if (!_rxCount)
   {
-    setMode(RF69_MODE_STANDBY); //enables interrupts
-    return true;
-  }
-  else if (_mode == RF69_MODE_RX)  //already in RX no payload yet
-  {
-    interrupts(); //explicitly re-enable interrupts
+    listen();
     return false;
   }
-  receiveBegin();
-  return false;
-//}
+  // the ISR never writes the head slot while it is occupied
+  RFM69Frame *frame = &_rxQueue[_rxHead];
+  DATALEN = frame->len;
+  SENDERID = frame->sender;
+  TARGETID = frame->target;
+  PAYLOADLEN = frame->len + 3;
+  ACK_RECEIVED = frame->ctl & RF69_CTL_SENDACK; //extract ACK-received flag
+  ACK_REQUESTED = frame->ctl & RF69_CTL_REQACK; //extract ACK-requested flag
+  _rssiRequested = (frame->ctl & (RF69_CTL_REQACK | RF69_CTL_RSSI)) == (RF69_CTL_REQACK | RF69_CTL_RSSI);
+  RSSI = frame->rssi;
+  for (byte i = 0; i < DATALEN; i++)
+    DATA[i] = frame->data[i];
+  if (DATALEN<RF69_MAX_DATA_LEN) DATA[DATALEN]=0; //add null at end of string
+  noInterrupts();
+  _rxHead = (_rxHead + 1) % RFM69_RX_QUEUE_SIZE;
+  _rxCount--;
+  interrupts();
+  return true;
 }
 
 // To enable encryption: radio.encrypt("ABCDEFGHIJKLMNOP");
@@ -32,6 +32,7 @@
 #ifndef RFM69_h
 #define RFM69_h
 #include <Arduino.h>            //assumes Arduino IDE v1.0 or greater
+#include <MyConfig.h>
 
 #define RF69_MAX_DATA_LEN         61 // to take advantage of the built in AES/CRC we want to limit the frame size to the internal FIFO size (66 bytes - 3 bytes overhead)
 #define RF69_SPI_CS               SS // SS is the SPI slave select pin, for instance D10 on atmega328
@@ -71,6 +72,25 @@
 #define COURSE_TEMP_COEF    -90 // puts the temperature reading in the ballpark, user can fine tune the returned value
 #define RF69_BROADCAST_ADDR 255
 #define RF69_CSMA_LIMIT_MS 1000
+#define RF69_TX_LIMIT_MS   1000 // give up on a frame the radio did not report as sent
+#define RF69_ATC_WINDOW       3 // automatic power control leaves the level alone within +/- this many dB of the target
+#define RF69_ATC_MISS_STEP    3 // power levels added for every ACK that did not arrive
+
+// sendStatus() results
+#define RF69_TX_IDLE          0 // nothing sent yet
+#define RF69_TX_BUSY          1 // waiting for channel, sending or waiting for ACK
+#define RF69_TX_OK            2 // sent (and ACKed if requested)
+#define RF69_TX_FAILED        3 // no ACK after all retries
+
+// frame queued by interruptHandler() until it is picked up by receiveDone()
+typedef struct {
+  byte len;     // data length
+  byte sender;
+  byte target;
+  byte ctl;     // ACK requested/received bits
+  int rssi;     // sampled before the receiver was re-armed
+  byte data[RF69_MAX_DATA_LEN];
+} RFM69Frame;
 
 class RFM69 {
   public:
@@ -81,7 +101,7 @@ class RFM69 {
     static volatile byte PAYLOADLEN;
     static volatile byte ACK_REQUESTED;
     static volatile byte ACK_RECEIVED; /// Should be polled immediately after sending a packet with ACK request
-    static volatile int RSSI; //most accurate RSSI during reception (closest to the reception)
+    static volatile int RSSI; //RSSI of the frame fetched by the last successful receiveDone()
     static volatile byte _mode; //should be protected?
     
     RFM69(byte slaveSelectPin=RF69_SPI_CS, byte interruptPin=RF69_IRQ_PIN, bool isRFM69HW=false, byte interruptNum=RF69_IRQ_NUM) {
@@ -92,6 +112,9 @@ class RFM69 {
       _promiscuousMode = false;
       _powerLevel = 31;
       _isRFM69HW = isRFM69HW;
+      _txState = RF69_TX_IDLE;
+      _targetRSSI = 0;
+      _rssiRequested = false;
     }
 
     bool initialize(byte freqBand, byte ID, byte networkID=1);
@@ -99,6 +122,9 @@ class RFM69 {
     bool canSend();
     void send(byte toAddress, const void* buffer, byte bufferSize, bool requestACK=false);
     bool sendWithRetry(byte toAddress, const void* buffer, byte bufferSize, byte retries=2, byte retryWaitTime=40); //40ms roundtrip req for  61byte packets
+    bool startSend(byte toAddress, const void* buffer, byte bufferSize, bool requestACK=false, byte retries=2, byte retryWaitTime=40);
+    bool startSendACK(const void* buffer = "", byte bufferSize=0);
+    byte sendStatus();
     bool receiveDone();
     bool ACKReceived(byte fromNodeID);
     bool ACKRequested();
@@ -110,6 +136,8 @@ class RFM69 {
     void promiscuous(bool onOff=true);
     void setHighPower(bool onOFF=true); //have to call it after initialize for RFM69HW
     void setPowerLevel(byte level); //reduce/increase transmit power level
+    byte getPowerLevel();
+    void enableAutoPower(int targetRSSI); //adjust power level from the RSSI reported in ACKs (0 = off)
     void sleep();
     byte readTemperature(byte calFactor=0); //get CMOS temperature (8bit)
     void rcCalibration(); //calibrate the internal RC oscillator for use in wide temperature variations - see datasheet section [4.3.5. RC Timer Accuracy]
@@ -123,8 +151,37 @@ class RFM69 {
     static void isr0();
     void virtual interruptHandler();
     void sendFrame(byte toAddress, const void* buffer, byte size, bool requestACK=false, bool sendACK=false);
+    void startFrame(byte toAddress, const void* buffer, byte size, bool requestACK, bool sendACK);
+    bool startTx(byte toAddress, const void* buffer, byte bufferSize, bool requestACK, bool sendACK, byte retries, byte retryWaitTime);
+    void autoPower(bool missed, int ackRSSI);
 
     static RFM69* selfPointer;
+    static volatile bool _frameSent; // set by interruptHandler() when a frame has left the radio
+
+    // frames received by interruptHandler(), oldest at _rxHead. The ISR only appends, receiveDone() only removes.
+    static RFM69Frame _rxQueue[RFM69_RX_QUEUE_SIZE];
+    static volatile byte _rxHead;
+    static volatile byte _rxCount;
+    // ACKs are kept apart so waiting for one does not consume queued data frames
+    static volatile bool _ackPending;
+    static volatile byte _ackSender;
+    static volatile int _ackRSSI; // RSSI reported by the last ACK (0 if none)
+
+    // automatic transmit power control
+    int _targetRSSI;
+    bool _rssiRequested; // last received frame asked for its RSSI in the ACK
+    byte _rssiOut; // -RSSI to put in the outgoing ACK (0 = none)
+
+    // background transmission, see startSend()
+    byte _txState;
+    byte _txBuf[RF69_MAX_DATA_LEN];
+    byte _txLen;
+    byte _txTo;
+    bool _txRequestACK;
+    bool _txIsACK;
+    byte _txRetries;
+    byte _txRetryWaitTime;
+    unsigned long _txTimer;
     byte _slaveSelectPin;
     byte _interruptPin;
     byte _interruptNum;
@@ -136,6 +193,7 @@ class RFM69 {
     byte _SPSR;
 
     void receiveBegin();
+    void listen();
     void setMode(byte mode);
     void setHighPowerRegs(bool onOff);
     void select();
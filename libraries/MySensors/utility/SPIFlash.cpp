@@ -48,6 +48,8 @@ uint8_t SPIFlash::UNIQUEID[8];
 SPIFlash::SPIFlash(uint8_t slaveSelectPin, uint16_t jedecID) {
   _slaveSelectPin = slaveSelectPin;
   _jedecID = jedecID;
+  _pendingBuf = NULL;
+  _pendingLen = 0;
 }
 
 /// Select the flash chip
@@ -226,6 +228,17 @@ void SPIFlash::writeByte(uint32_t addr, uint8_t byt) {
   unselect();
 }
 
+/// Program up to one page. The caller must make sure the range does not cross a page boundary
+void SPIFlash::programPage(uint32_t addr, const uint8_t* buf, uint16_t len) {
+  command(SPIFLASH_BYTEPAGEPROGRAM, true);  // Byte/Page Program
+  SPI.transfer(addr >> 16);
+  SPI.transfer(addr >> 8);
+  SPI.transfer(addr);
+  for (uint16_t i = 0; i < len; i++)
+    SPI.transfer(buf[i]);
+  unselect();
+}
+
 /// write multiple bytes to flash memory (up to 64K)
 /// WARNING: you can only write to previously erased memory locations (see datasheet)
 ///          use the block erase commands to first clear memory (write 0xFFs)
@@ -233,27 +246,61 @@ void SPIFlash::writeByte(uint32_t addr, uint8_t byt) {
 ///
 void SPIFlash::writeBytes(uint32_t addr, const void* buf, uint16_t len) {
   uint16_t n;
-  uint16_t maxBytes = 256-(addr%256);  // force the first set of bytes to stay within the first page
-  uint16_t offset = 0;
+  uint16_t maxBytes = SPIFLASH_PAGESIZE-(addr%SPIFLASH_PAGESIZE);  // force the first set of bytes to stay within the first page
+  const uint8_t* data = (const uint8_t*) buf;
   while (len>0)
   {
     n = (len<=maxBytes) ? len : maxBytes;
-    command(SPIFLASH_BYTEPAGEPROGRAM, true);  // Byte/Page Program
-    SPI.transfer(addr >> 16);
-    SPI.transfer(addr >> 8);
-    SPI.transfer(addr);
-    
-    for (uint16_t i = 0; i < n; i++)
-      SPI.transfer(((uint8_t*) buf)[offset + i]);
-    unselect();
-    
+    programPage(addr, data, n);
+
     addr+=n;  // adjust the addresses and remaining bytes by what we've just transferred.
-    offset +=n;
+    data+=n;
     len -= n;
-    maxBytes = 256;   // now we can do up to 256 bytes per loop
+    maxBytes = SPIFLASH_PAGESIZE;   // now we can do up to 256 bytes per loop
   }
 }
 
+/// Non blocking versions of the erase and write commands.
+/// These never wait for the chip: they return false if the chip (or a previously
+/// submitted write) is still busy, so the caller can go on with other work and retry later.
+boolean SPIFlash::submitErase4K(uint32_t addr) {
+  if (_pendingLen || busy()) return false;
+  blockErase4K(addr);
+  return true;
+}
+
+boolean SPIFlash::submitErase32K(uint32_t addr) {
+  if (_pendingLen || busy()) return false;
+  blockErase32K(addr);
+  return true;
+}
+
+/// Queue a write of len bytes. The data is split on page boundaries and one page
+/// is programmed per poll() while the chip is idle, so buf must stay valid until poll() returns true.
+/// WARNING: you can only write to previously erased memory locations (see datasheet)
+boolean SPIFlash::submitWrite(uint32_t addr, const void* buf, uint16_t len) {
+  if (_pendingLen) return false;
+  _pendingAddr = addr;
+  _pendingBuf = (const uint8_t*) buf;
+  _pendingLen = len;
+  poll();
+  return true;
+}
+
+/// Advance a submitted write by one page if the chip is ready.
+/// Returns true when all submitted erase/write operations have completed.
+boolean SPIFlash::poll() {
+  if (busy()) return false;
+  if (!_pendingLen) return true;
+  uint16_t maxBytes = SPIFLASH_PAGESIZE-(_pendingAddr%SPIFLASH_PAGESIZE);
+  uint16_t n = (_pendingLen<=maxBytes) ? _pendingLen : maxBytes;
+  programPage(_pendingAddr, _pendingBuf, n);
+  _pendingAddr += n;
+  _pendingBuf += n;
+  _pendingLen -= n;
+  return false;
+}
+
 /// erase entire flash memory array
 /// may take several seconds depending on size, but is non blocking
 /// so you may wait for this to complete using busy() or continue doing
@@ -86,6 +86,8 @@
                                               // Example for Atmel-Adesto 4Mbit AT25DF041A: 0x1F44 (page 27: http://www.adestotech.com/sites/default/files/datasheets/doc3668.pdf)
                                               // Example for Winbond 4Mbit W25X40CL: 0xEF30 (page 14: http://www.winbond.com/NR/rdonlyres/6E25084C-0BFE-4B25-903D-AE10221A0929/0/W25X40CL.pdf)
 #define SPIFLASH_MACREAD          0x4B        // read unique ID number (MAC)
+
+#define SPIFLASH_PAGESIZE         256         // bytes programmed by a single page program command
                                               
 class SPIFlash {
 public:
@@ -102,6 +104,10 @@ public:
   void chipErase();
   void blockErase4K(uint32_t address);
   void blockErase32K(uint32_t address);
+  boolean submitErase4K(uint32_t address);
+  boolean submitErase32K(uint32_t address);
+  boolean submitWrite(uint32_t addr, const void* buf, uint16_t len);
+  boolean poll();
   uint16_t readDeviceId();
   uint8_t* readUniqueId();
   
@@ -111,10 +117,14 @@ public:
 protected:
   void select();
   void unselect();
+  void programPage(uint32_t addr, const uint8_t* buf, uint16_t len);
   uint8_t _slaveSelectPin;
   uint16_t _jedecID;
   uint8_t _SPCR;
   uint8_t _SPSR;
+  const uint8_t* _pendingBuf;  // remaining data of a submitWrite() job
+  uint32_t _pendingAddr;
+  uint16_t _pendingLen;
 #ifdef SPI_HAS_TRANSACTION
   SPISettings _settings;
 #endif
@@ -4,6 +4,8 @@
 	#define PRIPSTR "%S"
 #elif defined(ESP8266)
 #include <pgmspace.h>
+#elif defined(__linux__)
+#include <avr/pgmspace.h> // host builds provide an emulation
 #endif
 #include "sha256.h"
 